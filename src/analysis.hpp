@@ -0,0 +1,111 @@
+#pragma once
+
+#include "search.hpp"
+#include "mailbox.hpp"
+
+#include <condition_variable>
+
+struct AnalysisInfo {
+    static constexpr u32 max_line = 32;
+
+    u64                        generation = {};
+    i32                        score      = {};
+    i32                        depth      = {};
+    u64                        nodes      = {};
+    u32                        length     = {};
+    std::array<Move, max_line> line       = {};
+};
+
+// Searches the latest position without limits on a background thread. Every
+// completed iteration lands in a mailbox the UI polls once per frame. A new
+// position stops the running search, which notices within a thousand nodes,
+// and the next one starts on the same, still warm, transposition table.
+struct Analyzer {
+    explicit Analyzer(size_t tt_megabytes) : engine(tt_megabytes) {
+        engine.on_iteration = [this](Position const& root, SearchResult const& result) {
+            report(root, result);
+        };
+        worker = std::thread([this]() { run(); });
+    }
+
+    Analyzer(Analyzer const&) = delete;
+    auto operator=(Analyzer const&) -> Analyzer& = delete;
+
+    ~Analyzer() {
+        {
+            auto lock = std::lock_guard(mutex);
+            quit = true;
+            generation.fetch_add(1, std::memory_order_relaxed);
+        }
+        engine.stop();
+        changed.notify_one();
+        worker.join();
+    }
+
+    void set_position(Position const& position) {
+        {
+            auto lock = std::lock_guard(mutex);
+            root = position;
+            generation.fetch_add(1, std::memory_order_relaxed);
+        }
+        engine.stop();
+        changed.notify_one();
+    }
+
+    // The newest result for the current position, if one arrived since the last call.
+    auto poll() -> Option<AnalysisInfo> {
+        auto info = mailbox.take();
+        if (!info || info->generation != generation.load(std::memory_order_relaxed)) {
+            return None;
+        }
+        return info;
+    }
+
+private:
+    Engine                  engine;
+    Mailbox<AnalysisInfo>   mailbox    = {};
+    std::mutex              mutex;
+    std::condition_variable changed;
+    Option<Position>        root       = None;
+    std::atomic_uint64_t    generation = 0;
+    std::atomic_uint64_t    searching  = 0;
+    bool                    quit       = false;
+    std::thread             worker;
+
+    // A position set between taking the lock and the search clearing its stop
+    // flag would otherwise be missed; the first iteration finishes at once and
+    // catches it here.
+    void report(Position const& position, SearchResult const& result) {
+        auto current = searching.load(std::memory_order_relaxed);
+        if (current != generation.load(std::memory_order_relaxed)) {
+            engine.stop();
+            return;
+        }
+        auto info = AnalysisInfo{
+            .generation = current,
+            .score = result.score,
+            .depth = result.depth,
+            .nodes = result.nodes,
+        };
+        info.length = engine.principal_variation(position, info.line);
+        mailbox.publish(info);
+    }
+
+    void run() {
+        auto seen = u64(0);
+        while (true) {
+            auto position = Position{};
+            {
+                auto lock = std::unique_lock(mutex);
+                changed.wait(lock, [&]() { return generation.load(std::memory_order_relaxed) != seen; });
+                if (quit) {
+                    return;
+                }
+                seen = generation.load(std::memory_order_relaxed);
+                position = *root;
+            }
+            searching.store(seen, std::memory_order_relaxed);
+            engine.search(position, SearchLimits{});
+        }
+    }
+};
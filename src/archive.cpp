@@ -0,0 +1,148 @@
+#include "rankcode.hpp"
+
+#include <charconv>
+#include <string_view>
+
+static auto parse_u64(std::string_view text) -> Option<u64> {
+    u64 value = {};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        return None;
+    }
+    return Some(u64(value));
+}
+
+static void print_usage() {
+    fmt::print(
+        "usage: corners_archive pack ARCHIVE OUT [--threads N]\n"
+        "       corners_archive unpack IN ARCHIVE\n"
+        "  ARCHIVE         games written by corners_match --archive; unpack replaces it\n"
+        "  --threads N     blocks encoded in parallel (all cores)\n"
+    );
+}
+
+static auto pack(char const* input, char const* output, u32 threads) -> i32 {
+    auto archive = GameArchive::open(input);
+    if (!archive) {
+        fmt::print(stderr, "failed to open '{}'\n", input);
+        return 1;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    auto blocks = (archive->size() + RankCode::block_games - 1) / RankCode::block_games;
+    auto coded = std::vector<std::vector<u8>>(blocks);
+    auto failed = std::atomic_bool{false};
+    auto next_block = std::atomic_size_t{0};
+    auto workers = std::vector<std::thread>{};
+    for (u32 t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            std::vector<GameView> games;
+            while (true) {
+                auto block = next_block.fetch_add(1, std::memory_order_relaxed);
+                if (block >= blocks) {
+                    return;
+                }
+                games.clear();
+                auto begin = block * RankCode::block_games;
+                for (auto i = begin; i < std::min<size_t>(begin + RankCode::block_games, archive->size()); ++i) {
+                    games.push_back((*archive)[i]);
+                }
+                if (!RankCode::encode_block(games, coded[block])) {
+                    failed.store(true, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (failed.load(std::memory_order_relaxed)) {
+        fmt::print(stderr, "'{}' holds an illegal move\n", input);
+        return 1;
+    }
+
+    auto file = File(std::fopen(output, "wb"));
+    std::array<u32, 2> header = {RankCode::magic, RankCode::version};
+    auto ok = file != nullptr && std::fwrite(header.data(), sizeof(header), 1, file.get()) == 1;
+    auto raw_moves = u64(0);
+    auto raw_bytes = u64(8);
+    auto coded_moves = u64(0);
+    auto coded_bytes = u64(sizeof(header));
+    for (size_t i = 0; i < archive->size(); ++i) {
+        raw_moves += (*archive)[i].moves.size() * sizeof(Move);
+        raw_bytes += (*archive)[i].header->record_size();
+    }
+    for (auto& block : coded) {
+        ok = ok && std::fwrite(block.data(), 1, block.size(), file.get()) == block.size();
+        auto block_header = RankCode::BlockHeader{};
+        std::memcpy(&block_header, block.data(), sizeof(block_header));
+        coded_moves += block_header.ranks_size;
+        coded_bytes += block.size();
+    }
+    if (!ok) {
+        fmt::print(stderr, "failed to write '{}'\n", output);
+        return 1;
+    }
+    auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+    fmt::print(
+        "{} games in {:.2f}s ({:.0f} games/s)\nmoves {} -> {} bytes ({:.2f}x, {:.2f} bits/move)\nfile  {} -> {} bytes ({:.2f}x)\n",
+        archive->size(), seconds, f64(archive->size()) / std::max(seconds, 1e-9),
+        raw_moves, coded_moves, f64(raw_moves) / f64(std::max<u64>(coded_moves, 1)),
+        f64(coded_moves) * 8.0 / f64(std::max<u64>(raw_moves / sizeof(Move), 1)),
+        raw_bytes, coded_bytes, f64(raw_bytes) / f64(std::max<u64>(coded_bytes, 1))
+    );
+    return 0;
+}
+
+static auto unpack(char const* input, char const* output) -> i32 {
+    auto file = MappedFile::open(input);
+    auto data = file ? std::span<u8 const>(file->data(), file->size()) : std::span<u8 const>();
+    if (data.size() < 8 || reinterpret_cast<u32 const*>(data.data())[0] != RankCode::magic || reinterpret_cast<u32 const*>(data.data())[1] != RankCode::version) {
+        fmt::print(stderr, "'{}' is not a packed archive\n", input);
+        return 1;
+    }
+    auto writer = GameRecordWriter::create(output);
+    if (!writer) {
+        fmt::print(stderr, "failed to open '{}'\n", output);
+        return 1;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    auto games = u64(0);
+    auto ok = true;
+    data = data.subspan(8);
+    while (ok && !data.empty()) {
+        ok = RankCode::decode_block(data, [&](GameHeader const& header, std::span<Move const> moves) {
+            ok = ok && writer->write(header, moves);
+            games += 1;
+        });
+    }
+    if (!ok || !writer->flush()) {
+        fmt::print(stderr, "failed to unpack '{}' after {} games\n", input, games);
+        return 1;
+    }
+    auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+    fmt::print("{} games in {:.2f}s ({:.0f} games/s)\n", games, seconds, f64(games) / std::max(seconds, 1e-9));
+    return 0;
+}
+
+auto main(i32 argc, const char* argv[]) -> i32 {
+    auto command = argc >= 4 ? std::string_view(argv[1]) : std::string_view();
+    if (command == "unpack" && argc == 4) {
+        return unpack(argv[2], argv[3]);
+    }
+    if (command != "pack" || (argc != 4 && argc != 6)) {
+        print_usage();
+        return 1;
+    }
+    auto threads = std::max(1U, std::thread::hardware_concurrency());
+    if (argc == 6) {
+        auto value = parse_u64(argv[5]);
+        if (std::string_view(argv[4]) != "--threads" || !value) {
+            print_usage();
+            return 1;
+        }
+        threads = std::max<u32>(1, u32(*value));
+    }
+    return pack(argv[2], argv[3], threads);
+}
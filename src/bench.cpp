@@ -0,0 +1,166 @@
+#include "search.hpp"
+#include "mcts.hpp"
+
+#include <charconv>
+#include <string_view>
+
+struct BenchConfig {
+    u64                 positions = 1 << 20;
+    u32                 repeat    = 8;
+    i32                 depth     = 7;
+    u32                 searches  = 16;
+    Option<std::string> mcts      = None;
+};
+
+static auto parse_u64(std::string_view text) -> Option<u64> {
+    u64 value = {};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        return None;
+    }
+    return Some(u64(value));
+}
+
+static void print_usage() {
+    fmt::print(
+        "usage: corners_bench [options]\n"
+        "  --positions N   random positions to evaluate (1048576)\n"
+        "  --repeat N      passes over them per benchmark (8)\n"
+        "  --depth N       fixed search depth (7)\n"
+        "  --searches N    positions to search (16)\n"
+        "  --mcts FILE     also compare MCTS playout rates with and without batched inference\n"
+        "Everything else runs on one thread, so rates are per core.\n"
+    );
+}
+
+static auto parse_args(i32 argc, const char* argv[]) -> Option<BenchConfig> {
+    auto config = BenchConfig{};
+    if (argc % 2 == 0) {
+        return None;
+    }
+    for (i32 i = 1; i + 1 < argc; i += 2) {
+        auto arg = std::string_view(argv[i]);
+        if (arg == "--mcts") {
+            config.mcts = Some(std::string(argv[i + 1]));
+            continue;
+        }
+        auto value = parse_u64(argv[i + 1]);
+        if (!value) {
+            return None;
+        }
+        if (arg == "--positions") {
+            config.positions = std::max<u64>(*value, 1);
+        } else if (arg == "--repeat") {
+            config.repeat = std::max(1U, u32(*value));
+        } else if (arg == "--depth") {
+            config.depth = std::max(1, i32(*value));
+        } else if (arg == "--searches") {
+            config.searches = u32(*value);
+        } else {
+            return None;
+        }
+    }
+    return Some(std::move(config));
+}
+
+// Positions from random playouts, spread over the whole game.
+static auto random_positions(u64 count) -> std::vector<Position> {
+    auto rng = std::mt19937_64(1);
+    auto positions = std::vector<Position>{};
+    positions.reserve(count);
+    auto position = Position::new_();
+    while (positions.size() < count) {
+        MoveList list;
+        position.generate_moves(list);
+        if (list.size == 0 || position.outcome() != Outcome::None) {
+            position = Position::new_();
+            continue;
+        }
+        position.make_move(list[u32(rng() % list.size)]);
+        positions.push_back(position);
+    }
+    return positions;
+}
+
+template<typename Fn>
+static auto timed(Fn&& fn) -> f64 {
+    auto started = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+}
+
+auto main(i32 argc, const char* argv[]) -> i32 {
+    auto parsed = parse_args(argc, argv);
+    if (!parsed) {
+        print_usage();
+        return 1;
+    }
+    auto config = std::move(parsed).unwrap();
+
+    auto positions = random_positions(config.positions);
+    auto params = EvalParams::new_();
+    auto scalar = std::vector<i32>(positions.size());
+    auto batch = std::vector<i32>(positions.size());
+    auto total = f64(positions.size()) * f64(config.repeat);
+
+    auto seconds = timed([&]() {
+        for (u32 r = 0; r < config.repeat; ++r) {
+            for (size_t i = 0; i < positions.size(); ++i) {
+                scalar[i] = Evaluator::evaluate(params, positions[i]);
+            }
+        }
+    });
+    fmt::print("eval          {:8.2f} Mpos/s\n", total / seconds / 1e6);
+
+    seconds = timed([&]() {
+        for (u32 r = 0; r < config.repeat; ++r) {
+            Evaluator::evaluate_batch(params, positions, batch);
+        }
+    });
+    fmt::print("eval batch    {:8.2f} Mpos/s\n", total / seconds / 1e6);
+    if (scalar != batch) {
+        fmt::print(stderr, "batch evaluation disagrees with the scalar one\n");
+        return 1;
+    }
+
+    u64 moves = 0;
+    seconds = timed([&]() {
+        MoveList list;
+        for (u32 r = 0; r < config.repeat; ++r) {
+            for (auto& position : positions) {
+                position.generate_moves(list);
+                moves += list.size;
+            }
+        }
+    });
+    fmt::print("movegen       {:8.2f} Mpos/s ({:.1f} moves each)\n", total / seconds / 1e6, f64(moves) / total);
+
+    auto engine = Engine(16);
+    u64 nodes = 0;
+    seconds = timed([&]() {
+        for (u32 i = 0; i < std::min<u64>(config.searches, positions.size()); ++i) {
+            engine.tt.clear();
+            auto& position = positions[i * (positions.size() / std::max(1U, config.searches))];
+            nodes += engine.search(position, SearchLimits{.depth = config.depth}).nodes;
+        }
+    });
+    fmt::print("search        {:8.2f} Mnps ({} nodes at depth {})\n", f64(nodes) / seconds / 1e6, nodes, config.depth);
+
+    if (config.mcts) {
+        auto policy = PolicyNetwork::load(config.mcts->c_str());
+        if (!policy) {
+            fmt::print(stderr, "failed to load policy network '{}'\n", *config.mcts);
+            return 1;
+        }
+        auto threads = std::max(1U, std::thread::hardware_concurrency());
+        for (auto batch : {1U, 16U}) {
+            auto mcts = Mcts(**policy, MctsConfig{.threads = std::max(threads, batch), .batch = batch});
+            u64 playouts = 0;
+            seconds = timed([&]() {
+                playouts = mcts.search(Position::new_(), SearchLimits{.nodes = 50000}).nodes;
+            });
+            fmt::print("mcts batch {:2}  {:8.2f} kplayouts/s (average batch {:.1f})\n", batch, f64(playouts) / seconds / 1e3, mcts.average_batch());
+        }
+    }
+    return 0;
+}
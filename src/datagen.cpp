@@ -0,0 +1,270 @@
+#include "search.hpp"
+#include "dataset.hpp"
+
+#include <charconv>
+#include <condition_variable>
+#include <string_view>
+
+struct DatagenConfig {
+    std::string output       = "data";
+    u64         positions    = 10000000;
+    u64         nodes        = 5000;
+    u32         threads      = std::max(1U, std::thread::hardware_concurrency());
+    u32         random_plies = 8;
+    u64         seed         = 1;
+    size_t      tt_megabytes = 16;
+    size_t      shard        = 1 << 22;
+};
+
+// Every shard holds exactly `shard` samples except possibly the last one.
+// Workers fill one buffer while the writer thread flushes the other, so
+// searching never waits on the disk unless a whole shard is still being
+// written when the next one fills up.
+struct ShardWriter {
+    ShardWriter(std::string prefix, size_t shard) : prefix(std::move(prefix)), shard(shard) {
+        filling.reserve(shard);
+        spare.reserve(shard);
+        writer = std::thread([this]() { run(); });
+    }
+
+    ShardWriter(ShardWriter const&) = delete;
+    auto operator=(ShardWriter const&) -> ShardWriter& = delete;
+
+    void push(std::span<Sample const> samples) {
+        auto lock = std::unique_lock(mutex);
+        for (auto& sample : samples) {
+            filling.push_back(sample);
+            if (filling.size() == shard) {
+                hand_over(lock);
+            }
+        }
+    }
+
+    // Flushes the partial shard and waits for the writer. False if any shard failed.
+    auto finish() -> bool {
+        {
+            auto lock = std::unique_lock(mutex);
+            if (!filling.empty()) {
+                hand_over(lock);
+            }
+            done = true;
+        }
+        changed.notify_all();
+        writer.join();
+        return ok;
+    }
+
+    [[nodiscard]] auto shards() const -> u32 {
+        return written;
+    }
+
+private:
+    std::string             prefix;
+    size_t                  shard;
+    std::mutex              mutex;
+    std::condition_variable changed;
+    std::vector<Sample>     filling    = {};
+    std::vector<Sample>     spare      = {};
+    bool                    spare_free = true;
+    bool                    full       = false;
+    bool                    done       = false;
+    bool                    ok         = true;
+    u32                     written    = 0;
+    std::thread             writer;
+
+    void hand_over(std::unique_lock<std::mutex>& lock) {
+        changed.wait(lock, [&]() { return spare_free; });
+        std::swap(filling, spare);
+        spare_free = false;
+        full = true;
+        changed.notify_all();
+    }
+
+    // `spare` belongs to this thread from the moment it is marked full until
+    // it is handed back empty, so the write itself runs unlocked.
+    void run() {
+        auto lock = std::unique_lock(mutex);
+        while (true) {
+            changed.wait(lock, [&]() { return full || done; });
+            if (!full) {
+                return;
+            }
+            full = false;
+            auto path = fmt::format("{}-{:05}.bin", prefix, written);
+            lock.unlock();
+
+            auto writer = SampleWriter::open(path.c_str(), false);
+            auto success = writer && writer->write(spare);
+
+            lock.lock();
+            if (!success) {
+                fmt::print(stderr, "failed to write '{}'\n", path);
+                ok = false;
+            }
+            written += 1;
+            spare.clear();
+            spare_free = true;
+            changed.notify_all();
+        }
+    }
+};
+
+static auto parse_u64(std::string_view text) -> Option<u64> {
+    u64 value = {};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        return None;
+    }
+    return Some(u64(value));
+}
+
+static void print_usage() {
+    fmt::print(
+        "usage: corners_datagen [options]\n"
+        "  --out PREFIX        shards are written to PREFIX-00000.bin, ... (data)\n"
+        "  --positions N       stop after this many labelled positions (10000000)\n"
+        "  --nodes N           search nodes per move (5000)\n"
+        "  --threads N         self-play threads (all cores)\n"
+        "  --random-plies N    random opening moves, not recorded (8)\n"
+        "  --seed N            opening seed (1)\n"
+        "  --hash MB           transposition table per thread (16)\n"
+        "  --shard N           samples per shard file (4194304)\n"
+        "Shards hold plain samples as read by corners_tune.\n"
+    );
+}
+
+static auto parse_args(i32 argc, const char* argv[]) -> Option<DatagenConfig> {
+    auto config = DatagenConfig{};
+    if (argc % 2 == 0) {
+        return None;
+    }
+    for (i32 i = 1; i + 1 < argc; i += 2) {
+        auto arg = std::string_view(argv[i]);
+        if (arg == "--out") {
+            config.output = argv[i + 1];
+            continue;
+        }
+        auto value = parse_u64(argv[i + 1]);
+        if (!value) {
+            return None;
+        }
+        if (arg == "--positions") {
+            config.positions = *value;
+        } else if (arg == "--nodes") {
+            config.nodes = std::max<u64>(*value, 1);
+        } else if (arg == "--threads") {
+            config.threads = std::max(1U, u32(*value));
+        } else if (arg == "--random-plies") {
+            config.random_plies = u32(*value);
+        } else if (arg == "--seed") {
+            config.seed = *value;
+        } else if (arg == "--hash") {
+            config.tt_megabytes = size_t(*value);
+        } else if (arg == "--shard") {
+            config.shard = std::max<size_t>(size_t(*value), 1);
+        } else {
+            return None;
+        }
+    }
+    return Some(std::move(config));
+}
+
+static auto make_opening(DatagenConfig const& config, u64 game) -> Position {
+    auto position = Position::new_();
+    auto rng = std::mt19937_64(config.seed * 0x9E3779B97F4A7C15ULL + game);
+    for (u32 i = 0; i < config.random_plies; ++i) {
+        MoveList list;
+        position.generate_moves(list);
+        if (list.size == 0) {
+            break;
+        }
+        auto next = position;
+        next.make_move(list[u32(rng() % list.size)]);
+        if (next.outcome() != Outcome::None) {
+            break;
+        }
+        position = next;
+    }
+    return position;
+}
+
+// Plays one game against itself and labels every searched position with its
+// White-relative score and the final result.
+static void play_game(Engine& engine, SearchLimits const& limits, Position position, std::vector<Sample>& samples) {
+    std::vector<std::pair<Position, i32>> played;
+    auto outcome = Outcome::None;
+    while (true) {
+        outcome = position.outcome();
+        if (outcome != Outcome::None) {
+            break;
+        }
+        auto result = engine.search(position, limits);
+        if (!result.best) {
+            outcome = position.side == Side::White ? Outcome::BlackWins : Outcome::WhiteWins;
+            break;
+        }
+        played.emplace_back(position, position.side == Side::White ? result.score : -result.score);
+        position.make_move(*result.best);
+    }
+
+    samples.clear();
+    for (auto& [played_position, score] : played) {
+        samples.push_back(Sample::new_(played_position, outcome, score));
+    }
+}
+
+auto main(i32 argc, const char* argv[]) -> i32 {
+    auto parsed = parse_args(argc, argv);
+    if (!parsed) {
+        print_usage();
+        return 1;
+    }
+    auto config = std::move(parsed).unwrap();
+
+    auto writer = ShardWriter(config.output, config.shard);
+    auto next_game = std::atomic_uint64_t{0};
+    auto recorded = std::atomic_uint64_t{0};
+    auto started = std::chrono::steady_clock::now();
+    auto report_mutex = std::mutex{};
+    auto reported = u64(0);
+
+    auto worker = [&]() {
+        auto engine = std::make_unique<Engine>(config.tt_megabytes);
+        auto limits = SearchLimits{.nodes = config.nodes};
+        std::vector<Sample> samples;
+
+        while (recorded.load(std::memory_order_relaxed) < config.positions) {
+            auto game = next_game.fetch_add(1, std::memory_order_relaxed);
+            engine->tt.clear();
+            play_game(*engine, limits, make_opening(config, game), samples);
+            writer.push(samples);
+
+            auto total = recorded.fetch_add(samples.size(), std::memory_order_relaxed) + samples.size();
+            auto lock = std::lock_guard(report_mutex);
+            if (total - reported >= 100000) {
+                reported = total;
+                auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+                fmt::print("{} positions from {} games ({:.0f} positions/s)\n", total, game + 1, f64(total) / std::max(seconds, 1e-9));
+                std::fflush(stdout);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (u32 i = 0; i < config.threads; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (!writer.finish()) {
+        return 1;
+    }
+    auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+    fmt::print(
+        "wrote {} positions to {} shards in {:.1f}s ({:.0f} positions/s)\n",
+        recorded.load(), writer.shards(), seconds, f64(recorded.load()) / std::max(seconds, 1e-9)
+    );
+    return 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "file.hpp"
+#include "position.hpp"
+
+// One labelled position from a finished game. `result` is from White's
+// point of view: +1 win, 0 draw, -1 loss. `score` is the search score from
+// White's point of view when the game was played by a searching engine, 0
+// otherwise.
+struct Sample {
+    u64 white  = {};
+    u64 black  = {};
+    u16 ply    = {};
+    u8  side   = {};
+    i8  result = {};
+    i16 score  = {};
+    u16 unused = {};
+
+    static auto new_(Position const& position, Outcome outcome, i32 score = 0) -> Sample {
+        return Sample{
+            .white = position.white,
+            .black = position.black,
+            .ply = position.ply,
+            .side = u8(position.side),
+            .result = i8(outcome == Outcome::WhiteWins ? 1 : outcome == Outcome::BlackWins ? -1 : 0),
+            .score = i16(std::clamp(score, -32767, 32767)),
+            .unused = 0,
+        };
+    }
+
+    [[nodiscard]] auto position() const -> Position {
+        return Position::from_bitboards(white, black, Side(side), ply);
+    }
+};
+
+static_assert(sizeof(Sample) == 24);
+
+struct SampleWriter {
+    static auto open(char const* path, bool append) -> Option<SampleWriter> {
+        auto file = File(std::fopen(path, append ? "ab" : "wb"));
+        if (file == nullptr) {
+            return None;
+        }
+        return Some(SampleWriter(std::move(file)));
+    }
+
+    auto write(std::span<Sample const> samples) -> bool {
+        return std::fwrite(samples.data(), sizeof(Sample), samples.size(), file.get()) == samples.size();
+    }
+
+private:
+    explicit SampleWriter(File file) : file(std::move(file)) {}
+
+    File file;
+};
+
+// Streams a sample file in fixed-size chunks so it never has to fit in memory.
+struct SampleReader {
+    static auto open(char const* path, size_t chunk) -> Option<SampleReader> {
+        auto file = File(std::fopen(path, "rb"));
+        if (file == nullptr) {
+            return None;
+        }
+        return Some(SampleReader(std::move(file), chunk));
+    }
+
+    auto next() -> std::span<Sample const> {
+        auto count = std::fread(buffer.data(), sizeof(Sample), buffer.size(), file.get());
+        return {buffer.data(), count};
+    }
+
+    void rewind() {
+        std::rewind(file.get());
+    }
+
+private:
+    explicit SampleReader(File file, size_t chunk) : file(std::move(file)), buffer(chunk) {}
+
+    File                file;
+    std::vector<Sample> buffer;
+};
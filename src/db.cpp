@@ -0,0 +1,209 @@
+#include "gamedb.hpp"
+#include "records.hpp"
+#include "notation.hpp"
+
+#include <charconv>
+#include <map>
+#include <string_view>
+
+static auto parse_u64(std::string_view text) -> Option<u64> {
+    u64 value = {};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        return None;
+    }
+    return Some(u64(value));
+}
+
+static void print_usage() {
+    fmt::print(
+        "usage: corners_db build ARCHIVE DB [--memory MB]\n"
+        "       corners_db query DB ARCHIVE [--list N] startpos|fen BOARD SIDE PLY [moves M1 M2 ...]\n"
+        "  ARCHIVE         games written by corners_match --archive\n"
+        "  --memory MB     memory for sorting before entries are spilled to a run (256)\n"
+        "  --list N        games to list for the position (10)\n"
+    );
+}
+
+struct Tally {
+    u64 white = {};
+    u64 draws = {};
+    u64 black = {};
+
+    void add(Outcome outcome) {
+        white += outcome == Outcome::WhiteWins ? 1 : 0;
+        black += outcome == Outcome::BlackWins ? 1 : 0;
+        draws += outcome == Outcome::WhiteWins || outcome == Outcome::BlackWins ? 0 : 1;
+    }
+
+    [[nodiscard]] auto games() const -> u64 {
+        return white + draws + black;
+    }
+
+    [[nodiscard]] auto format() const -> std::string {
+        auto score = (f64(white) + 0.5 * f64(draws)) / f64(std::max<u64>(games(), 1));
+        return fmt::format("{:>8} games  +{} ={} -{}  white scores {:.1f}%", games(), white, draws, black, score * 100.0);
+    }
+};
+
+static auto build(char const* archive_path, char const* db_path, size_t megabytes) -> i32 {
+    auto archive = GameArchive::open(archive_path);
+    if (!archive) {
+        fmt::print(stderr, "failed to open '{}'\n", archive_path);
+        return 1;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    auto builder = GameDatabaseBuilder::new_(db_path, (megabytes << 20) / sizeof(PositionEntry));
+    for (size_t i = 0; i < archive->size(); ++i) {
+        auto game = (*archive)[i];
+        auto position = game.start();
+        auto entry = PositionEntry{.key = position.hash, .game = u32(i), .ply = 0, .outcome = game.header->outcome};
+        for (size_t ply = 0; ; ++ply) {
+            entry.key = position.hash;
+            entry.ply = u16(ply);
+            if (!builder.add(entry)) {
+                fmt::print(stderr, "failed to write a run next to '{}'\n", db_path);
+                return 1;
+            }
+            if (ply == game.moves.size()) {
+                break;
+            }
+            position.make_move(game.moves[ply]);
+        }
+    }
+    auto runs = std::max<size_t>(builder.runs(), 1);
+    auto entries = builder.finish();
+    if (!entries) {
+        fmt::print(stderr, "failed to write '{}'\n", db_path);
+        return 1;
+    }
+    auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+    fmt::print("{} games, {} positions from {} runs in {:.2f}s\n", archive->size(), *entries, runs, seconds);
+    return 0;
+}
+
+static auto query(char const* db_path, char const* archive_path, u64 list, std::span<char const* const> spec) -> i32 {
+    auto usage = [&]() {
+        print_usage();
+        return 1;
+    };
+    if (spec.empty()) {
+        return usage();
+    }
+    auto position = Position::new_();
+    auto rest = spec.subspan(1);
+    if (std::string_view(spec[0]) == "fen") {
+        if (spec.size() < 4) {
+            return usage();
+        }
+        auto parsed = Notation::from_fen(fmt::format("{} {} {}", spec[1], spec[2], spec[3]));
+        if (!parsed) {
+            fmt::print(stderr, "bad fen\n");
+            return 1;
+        }
+        position = *parsed;
+        rest = spec.subspan(4);
+    } else if (std::string_view(spec[0]) != "startpos") {
+        return usage();
+    }
+    if (!rest.empty()) {
+        if (std::string_view(rest[0]) != "moves") {
+            return usage();
+        }
+        for (auto text : rest.subspan(1)) {
+            auto move = Notation::parse_move(text);
+            if (!move || !position.is_legal(*move)) {
+                fmt::print(stderr, "illegal move '{}'\n", text);
+                return 1;
+            }
+            position.make_move(*move);
+        }
+    }
+
+    auto db = GameDatabase::open(db_path);
+    if (!db) {
+        fmt::print(stderr, "failed to open '{}'\n", db_path);
+        return 1;
+    }
+    auto archive = GameArchive::open(archive_path);
+    if (!archive) {
+        fmt::print(stderr, "failed to open '{}'\n", archive_path);
+        return 1;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    auto found = db->find(position.hash);
+    auto total = Tally{};
+    auto replies = std::map<Move, Tally>{};
+    auto games = std::vector<PositionEntry>{};
+    for (auto& entry : found) {
+        // A game that comes back to the position counts once, at its first visit.
+        if (!games.empty() && games.back().game == entry.game) {
+            continue;
+        }
+        games.push_back(entry);
+        total.add(entry.outcome);
+        if (entry.game < archive->size()) {
+            auto game = (*archive)[entry.game];
+            if (entry.ply < game.moves.size()) {
+                replies[game.moves[entry.ply]].add(entry.outcome);
+            }
+        }
+    }
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+
+    fmt::print("{}\n{}\n", Notation::to_fen(position), total.format());
+    std::vector<std::pair<Move, Tally>> sorted(replies.begin(), replies.end());
+    std::sort(sorted.begin(), sorted.end(), [](auto const& a, auto const& b) { return a.second.games() > b.second.games(); });
+    for (auto& [move, tally] : sorted) {
+        fmt::print("  {}  {}\n", Notation::move(move), tally.format());
+    }
+    for (size_t i = 0; i < std::min<size_t>(games.size(), list); ++i) {
+        auto& entry = games[i];
+        if (entry.game >= archive->size()) {
+            continue;
+        }
+        auto& header = *(*archive)[entry.game].header;
+        auto result = header.outcome == Outcome::WhiteWins ? "1-0" : header.outcome == Outcome::BlackWins ? "0-1" : "1/2";
+        fmt::print("  game {} ply {}  {} - {}  {}\n", entry.game, entry.ply, header.player(Side::White), header.player(Side::Black), result);
+    }
+    fmt::print("lookup {:.3f} ms\n", f64(micros) / 1000.0);
+    return 0;
+}
+
+auto main(i32 argc, const char* argv[]) -> i32 {
+    auto command = argc >= 4 ? std::string_view(argv[1]) : std::string_view();
+    auto args = std::span(argv, size_t(argc)).subspan(std::min(argc, 4));
+
+    if (command == "build") {
+        auto megabytes = u64(256);
+        if (args.size() == 2 && std::string_view(args[0]) == "--memory") {
+            auto value = parse_u64(args[1]);
+            if (!value || *value == 0) {
+                print_usage();
+                return 1;
+            }
+            megabytes = *value;
+        } else if (!args.empty()) {
+            print_usage();
+            return 1;
+        }
+        return build(argv[2], argv[3], size_t(megabytes));
+    }
+    if (command == "query") {
+        auto list = u64(10);
+        if (args.size() >= 2 && std::string_view(args[0]) == "--list") {
+            auto value = parse_u64(args[1]);
+            if (!value) {
+                print_usage();
+                return 1;
+            }
+            list = *value;
+            args = args.subspan(2);
+        }
+        return query(argv[2], argv[3], list, args);
+    }
+    print_usage();
+    return 1;
+}
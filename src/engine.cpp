@@ -0,0 +1,246 @@
+#include "game.hpp"
+#include "notation.hpp"
+#include "search.hpp"
+
+#include <charconv>
+#include <condition_variable>
+#include <iostream>
+#include <string_view>
+
+// Both threads write here; every line goes out whole and is flushed at once
+// because the manager on the other end of the pipe reads line by line.
+static std::mutex output_mutex;
+
+template<typename... Args>
+static void send(fmt::format_string<Args...> format, Args&&... args) {
+    auto line = fmt::format(format, std::forward<Args>(args)...);
+    line.push_back('\n');
+    auto lock = std::lock_guard(output_mutex);
+    std::fwrite(line.data(), 1, line.size(), stdout);
+    std::fflush(stdout);
+}
+
+static auto parse_u64(std::string_view text) -> Option<u64> {
+    u64 value = {};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        return None;
+    }
+    return Some(u64(value));
+}
+
+static auto split(std::string_view line) -> std::vector<std::string_view> {
+    std::vector<std::string_view> tokens;
+    while (true) {
+        auto start = line.find_first_not_of(" \t\r");
+        if (start == std::string_view::npos) {
+            return tokens;
+        }
+        line.remove_prefix(start);
+        auto end = std::min(line.find_first_of(" \t\r"), line.size());
+        tokens.push_back(line.substr(0, end));
+        line.remove_prefix(end);
+    }
+}
+
+// Decided scores are reported as moves to the end of the game, like mates.
+static auto format_score(i32 score) -> std::string {
+    if (std::abs(score) >= Score::decided) {
+        auto plies = Score::win - std::abs(score);
+        return fmt::format("mate {}", score > 0 ? (plies + 1) / 2 : -(plies + 1) / 2);
+    }
+    return fmt::format("cp {}", score);
+}
+
+// The reader thread only parses commands; searches run on their own thread,
+// so `stop`, `isready` and `quit` are answered while the engine is thinking.
+struct Protocol {
+    size_t                  tt_megabytes = 16;
+    std::unique_ptr<Engine> engine       = std::make_unique<Engine>(16);
+    Game                    game         = Game::new_();
+
+    ~Protocol() {
+        finish();
+    }
+
+    // False once the manager asked us to quit.
+    auto handle(std::string_view line) -> bool {
+        auto tokens = split(line);
+        if (tokens.empty()) {
+            return true;
+        }
+        auto command = tokens[0];
+        auto args = std::span(tokens).subspan(1);
+        if (command == "uci") {
+            send("id name Corners");
+            send("option name Hash type spin default 16 min 1 max 65536");
+            send("uciok");
+        } else if (command == "isready") {
+            send("readyok");
+        } else if (command == "setoption") {
+            set_option(args);
+        } else if (command == "ucinewgame") {
+            finish();
+            engine->tt.clear();
+        } else if (command == "position") {
+            finish();
+            set_position(args);
+        } else if (command == "go") {
+            finish();
+            go(args);
+        } else if (command == "stop") {
+            request_stop();
+        } else if (command == "quit") {
+            return false;
+        } else {
+            send("info string unknown command '{}'", command);
+        }
+        return true;
+    }
+
+private:
+    std::thread             searcher;
+    std::mutex              mutex;
+    std::condition_variable stop_changed;
+    bool                    stop_requested = false;
+
+    void request_stop() {
+        {
+            auto lock = std::lock_guard(mutex);
+            stop_requested = true;
+        }
+        stop_changed.notify_all();
+        engine->stop();
+    }
+
+    // Stops a running search, which still prints its bestmove, and waits for it.
+    void finish() {
+        if (searcher.joinable()) {
+            request_stop();
+            searcher.join();
+        }
+    }
+
+    void set_option(std::span<std::string_view const> args) {
+        if (args.size() == 4 && args[0] == "name" && args[1] == "Hash" && args[2] == "value") {
+            if (auto megabytes = parse_u64(args[3])) {
+                tt_megabytes = std::clamp<size_t>(*megabytes, 1, 65536);
+                finish();
+                engine = std::make_unique<Engine>(tt_megabytes);
+                return;
+            }
+        }
+        send("info string unsupported option");
+    }
+
+    // position startpos|fen <board> <side> <ply> [moves m1 m2 ...]
+    void set_position(std::span<std::string_view const> args) {
+        auto rest = args.empty() ? args : args.subspan(1);
+        if (!args.empty() && args[0] == "startpos") {
+            game = Game::new_();
+        } else if (args.size() >= 4 && args[0] == "fen") {
+            auto fen = fmt::format("{} {} {}", args[1], args[2], args[3]);
+            auto position = Notation::from_fen(fen);
+            if (!position) {
+                send("info string bad fen '{}'", fen);
+                return;
+            }
+            game = Game::from_position(*position);
+            rest = args.subspan(4);
+        } else {
+            send("info string expected 'position startpos|fen ... [moves ...]'");
+            return;
+        }
+        if (rest.empty() || rest[0] != "moves") {
+            return;
+        }
+        for (auto text : rest.subspan(1)) {
+            auto move = Notation::parse_move(text);
+            if (!move || !game.play(*move)) {
+                send("info string illegal move '{}'", text);
+                return;
+            }
+        }
+    }
+
+    // go [wtime N] [btime N] [winc N] [binc N] [movetime N] [depth N] [nodes N] [infinite]
+    void go(std::span<std::string_view const> args) {
+        auto limits = SearchLimits{};
+        auto clocks = std::array<Clock, 2>{};
+        auto clocked = false;
+        auto infinite = false;
+        for (size_t i = 0; i < args.size(); ++i) {
+            if (args[i] == "infinite") {
+                infinite = true;
+                continue;
+            }
+            auto value = i + 1 < args.size() ? parse_u64(args[i + 1]) : Option<u64>(None);
+            if (!value) {
+                send("info string bad value for '{}'", args[i]);
+                return;
+            }
+            auto ms = std::chrono::milliseconds(*value);
+            if (args[i] == "wtime" || args[i] == "btime") {
+                clocks[args[i][0] == 'w' ? 0 : 1].remaining = ms;
+                clocked = true;
+            } else if (args[i] == "winc" || args[i] == "binc") {
+                clocks[args[i][0] == 'w' ? 0 : 1].increment = ms;
+            } else if (args[i] == "movetime") {
+                limits.time = ms;
+            } else if (args[i] == "depth") {
+                limits.depth = i32(std::min<u64>(*value, 64));
+            } else if (args[i] == "nodes") {
+                limits.nodes = *value;
+            } else {
+                send("info string unknown go option '{}'", args[i]);
+                return;
+            }
+            ++i;
+        }
+        if (clocked && !infinite) {
+            limits.clock = Some(Clock(clocks[size_t(game.position.side)]));
+        }
+
+        // The ticket is taken here so a stop sent before the thread gets
+        // going still ends the search.
+        stop_requested = false;
+        searcher = std::thread([this, limits, infinite, root = game.position, ticket = engine->ticket()]() {
+            auto started = std::chrono::steady_clock::now();
+            engine->on_iteration = [&](Position const& position, SearchResult const& result) {
+                // The table outlives this search, so its line can run deeper than the iteration.
+                std::array<Move, 64> line;
+                auto length = engine->principal_variation(position, std::span(line).first(std::min<size_t>(size_t(result.depth), line.size())));
+                auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+                std::string pv;
+                for (u32 i = 0; i < length; ++i) {
+                    pv += (i == 0 ? "" : " ") + Notation::move(line[i]);
+                }
+                send(
+                    "info depth {} score {} nodes {} nps {} time {} pv {}",
+                    result.depth, format_score(result.score), result.nodes,
+                    result.nodes * 1000000 / u64(std::max<i64>(micros, 1)), micros / 1000, pv
+                );
+            };
+            auto result = engine->search(root, limits, ticket);
+            engine->on_iteration = {};
+
+            // In infinite mode the answer is held back until the manager asks for it.
+            if (infinite) {
+                auto lock = std::unique_lock(mutex);
+                stop_changed.wait(lock, [&]() { return stop_requested; });
+            }
+            send("bestmove {}", result.best ? Notation::move(*result.best) : std::string("0000"));
+        });
+    }
+};
+
+auto main() -> i32 {
+    auto protocol = Protocol{};
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (!protocol.handle(line)) {
+            break;
+        }
+    }
+    return 0;
+}
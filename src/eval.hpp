@@ -0,0 +1,150 @@
+#pragma once
+
+#include "file.hpp"
+#include "position.hpp"
+
+// Every term is linear in its weight so the tuner can fit them directly.
+// Tables are written from White's point of view (racing towards square 0);
+// Black's pieces read them through the 180 degree rotation `63 - square`.
+struct EvalParams {
+    std::array<i32, 64> distance = {};
+    i32                 home     = {};
+    i32                 blocked  = {};
+    i32                 tempo    = {};
+
+    static constexpr u32 magic = 0x50564543; // "CEVP"
+
+    static auto new_() -> EvalParams {
+        EvalParams params = {};
+        for (i32 y = 0; y < 8; ++y) {
+            for (i32 x = 0; x < 8; ++x) {
+                auto in_camp = x < 3 && y < 3;
+                params.distance[x + y * 8] = 8 * (14 - x - y) - 2 * std::abs(x - y) + (in_camp ? 16 : 0);
+            }
+        }
+        params.home = 12;
+        params.blocked = 6;
+        params.tempo = 4;
+        return params;
+    }
+
+    static auto load(char const* path) -> Option<EvalParams> {
+        auto file = File(std::fopen(path, "rb"));
+        if (file == nullptr) {
+            return None;
+        }
+        u32 header;
+        EvalParams params = {};
+        if (std::fread(&header, sizeof(header), 1, file.get()) != 1 || header != magic) {
+            return None;
+        }
+        if (std::fread(&params, sizeof(params), 1, file.get()) != 1) {
+            return None;
+        }
+        return Some(EvalParams(params));
+    }
+
+    auto save(char const* path) const -> bool {
+        auto file = File(std::fopen(path, "wb"));
+        if (file == nullptr) {
+            return false;
+        }
+        return std::fwrite(&magic, sizeof(magic), 1, file.get()) == 1
+            && std::fwrite(this, sizeof(*this), 1, file.get()) == 1;
+    }
+};
+
+struct Evaluator {
+    static constexpr auto oriented(Side side, i32 square) -> i32 {
+        return side == Side::White ? square : 63 - square;
+    }
+
+    // Pieces with no empty orthogonal neighbour can only leave by jumping.
+    static auto blocked(Position const& position, Side side) -> u64 {
+        auto empty = ~position.occupied();
+        return position.pieces(side) & ~Bitboard::neighbours(empty);
+    }
+
+    static auto side_score(EvalParams const& params, Position const& position, Side side) -> i32 {
+        auto pieces = position.pieces(side);
+
+        i32 score = 0;
+        for (auto bits = pieces; bits != 0; bits &= bits - 1) {
+            score += params.distance[oriented(side, std::countr_zero(bits))];
+        }
+        score -= params.home * std::popcount(pieces & Bitboard::home(side));
+        score -= params.blocked * std::popcount(blocked(position, side));
+        return score;
+    }
+
+    // Score from the point of view of the side to move.
+    static auto evaluate(EvalParams const& params, Position const& position) -> i32 {
+        auto us = side_score(params, position, position.side);
+        auto them = side_score(params, position, ~position.side);
+        return us - them + params.tempo;
+    }
+
+    static constexpr size_t batch_lanes = 64;
+
+    // Same scores as `evaluate`, for many unrelated positions at once. Piece
+    // sets are split into bytes, each looked up in a table of summed square
+    // weights with the home term folded in, and every block of positions is
+    // transposed into per-byte arrays so the lookups run across positions
+    // without branches.
+    static void evaluate_batch(EvalParams const& params, std::span<Position const> positions, std::span<i32> scores) {
+        std::array<std::array<i32, 256>, 8> white_table;
+        std::array<std::array<i32, 256>, 8> black_table;
+        for (i32 byte = 0; byte < 8; ++byte) {
+            white_table[byte][0] = 0;
+            black_table[byte][0] = 0;
+            for (u32 value = 1; value < 256; ++value) {
+                auto square = byte * 8 + std::countr_zero(value);
+                auto bit = Bitboard::bit(square);
+                auto white = params.distance[square] - ((Bitboard::home(Side::White) & bit) != 0 ? params.home : 0);
+                auto black = params.distance[63 - square] - ((Bitboard::home(Side::Black) & bit) != 0 ? params.home : 0);
+                white_table[byte][value] = white_table[byte][value & (value - 1)] + white;
+                black_table[byte][value] = black_table[byte][value & (value - 1)] + black;
+            }
+        }
+
+        alignas(32) std::array<std::array<u8, batch_lanes>, 8> white_bytes = {};
+        alignas(32) std::array<std::array<u8, batch_lanes>, 8> black_bytes = {};
+        alignas(32) std::array<u64, batch_lanes> white_sets = {};
+        alignas(32) std::array<u64, batch_lanes> black_sets = {};
+        alignas(32) std::array<u8, batch_lanes> sides = {};
+        alignas(32) std::array<i32, batch_lanes> score;
+
+        auto count = std::min(positions.size(), scores.size());
+        for (size_t base = 0; base < count; base += batch_lanes) {
+            auto lanes = std::min(batch_lanes, count - base);
+            for (size_t i = 0; i < lanes; ++i) {
+                auto& position = positions[base + i];
+                for (u32 byte = 0; byte < 8; ++byte) {
+                    white_bytes[byte][i] = u8(position.white >> (byte * 8));
+                    black_bytes[byte][i] = u8(position.black >> (byte * 8));
+                }
+                white_sets[i] = position.white;
+                black_sets[i] = position.black;
+                sides[i] = u8(position.side);
+            }
+
+            score.fill(0);
+            for (u32 byte = 0; byte < 8; ++byte) {
+                auto& white = white_table[byte];
+                auto& black = black_table[byte];
+                for (size_t i = 0; i < batch_lanes; ++i) {
+                    score[i] += white[white_bytes[byte][i]] - black[black_bytes[byte][i]];
+                }
+            }
+
+            for (size_t i = 0; i < batch_lanes; ++i) {
+                auto white = white_sets[i];
+                auto black = black_sets[i];
+                auto open = Bitboard::neighbours(~(white | black));
+                score[i] -= params.blocked * (std::popcount(white & ~open) - std::popcount(black & ~open));
+                score[i] = (sides[i] == 0 ? score[i] : -score[i]) + params.tempo;
+            }
+            std::copy_n(score.begin(), lanes, scores.begin() + base);
+        }
+    }
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdio>
+
+struct FileDrop {
+    void operator()(std::FILE* ptr) {
+        std::fclose(ptr);
+    }
+};
+
+using File = std::unique_ptr<std::FILE, FileDrop>;
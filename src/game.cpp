@@ -0,0 +1,85 @@
+#include "game.hpp"
+
+auto Game::new_() -> Game {
+    return from_position(Position::new_());
+}
+
+auto Game::from_position(Position const& position) -> Game {
+    return Game{.position = position};
+}
+
+auto Game::destinations(i32 square) const -> u64 {
+    if (square < 0 || square >= 64 || outcome() != Outcome::None) {
+        return 0;
+    }
+    if ((position.pieces(position.side) & Bitboard::bit(square)) == 0) {
+        return 0;
+    }
+    return position.destinations(square);
+}
+
+auto Game::is_legal(Move move) const -> bool {
+    return move.to < 64 && (destinations(move.from) & Bitboard::bit(move.to)) != 0;
+}
+
+auto Game::piece_at(i32 square) const -> Option<Side> {
+    if ((position.white & Bitboard::bit(square)) != 0) {
+        return Some(Side::White);
+    }
+    if ((position.black & Bitboard::bit(square)) != 0) {
+        return Some(Side::Black);
+    }
+    return None;
+}
+
+auto Game::outcome() const -> Outcome {
+    return outcome_of(position);
+}
+
+auto Game::outcome_of(Position const& position) -> Outcome {
+    auto outcome = position.outcome();
+    if (outcome != Outcome::None) {
+        return outcome;
+    }
+    MoveList list;
+    position.generate_moves(list);
+    if (list.size == 0) {
+        return position.side == Side::White ? Outcome::BlackWins : Outcome::WhiteWins;
+    }
+    return Outcome::None;
+}
+
+auto Game::play(Move move) -> bool {
+    if (!is_legal(move)) {
+        return false;
+    }
+    if (!undone.empty() && undone.back() == move) {
+        undone.pop_back();
+    } else {
+        undone.clear();
+    }
+    position.make_move(move);
+    moves.push_back(move);
+    return true;
+}
+
+auto Game::undo() -> bool {
+    if (moves.empty()) {
+        return false;
+    }
+    position.unmake_move(moves.back());
+    undone.push_back(moves.back());
+    moves.pop_back();
+    return true;
+}
+
+auto Game::redo() -> bool {
+    if (undone.empty()) {
+        return false;
+    }
+    auto move = undone.back();
+    undone.pop_back();
+    position.make_move(move);
+    moves.push_back(move);
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "position.hpp"
+
+// A game in progress: the position and the moves that led to it. Unlike
+// Position::outcome() it also knows that a side without a legal move loses,
+// and it only accepts legal moves, so front ends can pass user input as is.
+struct Game {
+    Position          position = Position::new_();
+    std::vector<Move> moves    = {};
+    std::vector<Move> undone   = {};
+
+    static auto new_() -> Game;
+    static auto from_position(Position const& position) -> Game;
+
+    // Squares the piece on `square` can reach, or nothing if it does not
+    // belong to the side to move or the game is over.
+    [[nodiscard]] auto destinations(i32 square) const -> u64;
+    [[nodiscard]] auto is_legal(Move move) const -> bool;
+    [[nodiscard]] auto piece_at(i32 square) const -> Option<Side>;
+    [[nodiscard]] auto outcome() const -> Outcome;
+
+    // The same rules for a bare position, for code that keeps no history.
+    static auto outcome_of(Position const& position) -> Outcome;
+
+    // False, leaving the game untouched, if the move is not legal here.
+    // Playing anything but the next undone move forgets the undone ones.
+    auto play(Move move) -> bool;
+
+    // Step back and forth through the moves; false when there is nothing
+    // to take back or replay.
+    auto undo() -> bool;
+    auto redo() -> bool;
+};
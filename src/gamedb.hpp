@@ -0,0 +1,202 @@
+#pragma once
+
+#include "file.hpp"
+#include "mapped.hpp"
+#include "position.hpp"
+
+#include <queue>
+#include <string>
+
+// One position reached in one game. `ply` counts moves from the start of
+// the recorded game, so it indexes the game's move list directly; `outcome`
+// is copied from the game header so statistics need nothing else.
+struct PositionEntry {
+    u64     key     = {};
+    u32     game    = {};
+    u16     ply     = {};
+    Outcome outcome = {};
+    u8      unused  = {};
+
+    friend constexpr auto operator<=>(PositionEntry const&, PositionEntry const&) noexcept = default;
+};
+
+static_assert(sizeof(PositionEntry) == 16);
+
+struct GameDatabaseLayout {
+    static constexpr u32 magic   = 0x42445043; // "CPDB"
+    static constexpr u32 version = 1;
+};
+
+struct GameDatabaseHeader {
+    u32 magic   = GameDatabaseLayout::magic;
+    u32 version = GameDatabaseLayout::version;
+    u64 entries = {};
+};
+
+static_assert(sizeof(GameDatabaseHeader) == 16);
+
+// Builds the database with a bounded amount of memory: entries are sorted in
+// runs of `run_entries`, each run is spilled to "<out>.runN", and the runs
+// are merged into the final file through one small buffer per run.
+struct GameDatabaseBuilder {
+    static constexpr size_t read_buffer = 4096;
+
+    static auto new_(std::string path, size_t run_entries) -> GameDatabaseBuilder {
+        auto builder = GameDatabaseBuilder{};
+        builder.path = std::move(path);
+        builder.run_entries = std::max<size_t>(run_entries, 1024);
+        builder.buffer.reserve(builder.run_entries);
+        return builder;
+    }
+
+    auto add(PositionEntry const& entry) -> bool {
+        buffer.push_back(entry);
+        return buffer.size() < run_entries || spill();
+    }
+
+    [[nodiscard]] auto runs() const -> size_t {
+        return run_paths.size();
+    }
+
+    // Merges every run into `path` and removes them. Returns the entry count.
+    auto finish() -> Option<u64> {
+        if (!buffer.empty() && !spill()) {
+            return None;
+        }
+        auto out = File(std::fopen(path.c_str(), "wb"));
+        if (out == nullptr) {
+            return None;
+        }
+        auto header = GameDatabaseHeader{};
+        if (std::fwrite(&header, sizeof(header), 1, out.get()) != 1) {
+            return None;
+        }
+
+        std::vector<Run> inputs;
+        for (auto& run_path : run_paths) {
+            auto file = File(std::fopen(run_path.c_str(), "rb"));
+            if (file == nullptr) {
+                return None;
+            }
+            inputs.push_back(Run{.file = std::move(file)});
+        }
+
+        using Head = std::pair<PositionEntry, size_t>;
+        std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (auto entry = inputs[i].next()) {
+                heads.emplace(*entry, i);
+            }
+        }
+
+        std::vector<PositionEntry> output;
+        output.reserve(read_buffer);
+        while (!heads.empty()) {
+            auto [entry, run] = heads.top();
+            heads.pop();
+            output.push_back(entry);
+            header.entries += 1;
+            if (output.size() == read_buffer) {
+                if (std::fwrite(output.data(), sizeof(PositionEntry), output.size(), out.get()) != output.size()) {
+                    return None;
+                }
+                output.clear();
+            }
+            if (auto next = inputs[run].next()) {
+                heads.emplace(*next, run);
+            }
+        }
+        if (std::fwrite(output.data(), sizeof(PositionEntry), output.size(), out.get()) != output.size()) {
+            return None;
+        }
+
+        std::rewind(out.get());
+        if (std::fwrite(&header, sizeof(header), 1, out.get()) != 1) {
+            return None;
+        }
+        inputs.clear();
+        for (auto& run_path : run_paths) {
+            std::remove(run_path.c_str());
+        }
+        run_paths.clear();
+        return Some(u64(header.entries));
+    }
+
+private:
+    struct Run {
+        File                       file;
+        std::vector<PositionEntry> buffer = {};
+        size_t                     next_index = 0;
+
+        auto next() -> Option<PositionEntry> {
+            if (next_index == buffer.size()) {
+                buffer.resize(read_buffer);
+                buffer.resize(std::fread(buffer.data(), sizeof(PositionEntry), read_buffer, file.get()));
+                next_index = 0;
+                if (buffer.empty()) {
+                    return None;
+                }
+            }
+            return Some(PositionEntry(buffer[next_index++]));
+        }
+    };
+
+    std::string                path        = {};
+    size_t                     run_entries = {};
+    std::vector<PositionEntry> buffer      = {};
+    std::vector<std::string>   run_paths   = {};
+
+    auto spill() -> bool {
+        std::sort(buffer.begin(), buffer.end());
+        auto run_path = fmt::format("{}.run{}", path, run_paths.size());
+        auto file = File(std::fopen(run_path.c_str(), "wb"));
+        if (file == nullptr) {
+            return false;
+        }
+        run_paths.push_back(run_path);
+        auto ok = std::fwrite(buffer.data(), sizeof(PositionEntry), buffer.size(), file.get()) == buffer.size();
+        buffer.clear();
+        return ok;
+    }
+};
+
+// The finished database: entries sorted by key, mapped read-only, so a
+// lookup is a binary search touching a few dozen pages at most.
+struct GameDatabase {
+    static auto open(char const* path) -> Option<GameDatabase> {
+        auto file = MappedFile::open(path);
+        if (!file || file->size() < sizeof(GameDatabaseHeader)) {
+            return None;
+        }
+        auto& header = *reinterpret_cast<GameDatabaseHeader const*>(file->data());
+        if (header.magic != GameDatabaseLayout::magic || header.version != GameDatabaseLayout::version) {
+            return None;
+        }
+        if (file->size() != sizeof(GameDatabaseHeader) + header.entries * sizeof(PositionEntry)) {
+            return None;
+        }
+        return Some(GameDatabase(std::move(file).unwrap()));
+    }
+
+    [[nodiscard]] auto entries() const -> std::span<PositionEntry const> {
+        auto& header = *reinterpret_cast<GameDatabaseHeader const*>(file.data());
+        return {reinterpret_cast<PositionEntry const*>(file.data() + sizeof(GameDatabaseHeader)), header.entries};
+    }
+
+    // Every occurrence of `key`, ordered by game and ply.
+    [[nodiscard]] auto find(u64 key) const -> std::span<PositionEntry const> {
+        auto all = entries();
+        auto first = std::lower_bound(all.begin(), all.end(), key, [](PositionEntry const& entry, u64 key) {
+            return entry.key < key;
+        });
+        auto last = std::upper_bound(first, all.end(), key, [](u64 key, PositionEntry const& entry) {
+            return key < entry.key;
+        });
+        return {first, last};
+    }
+
+private:
+    MappedFile file;
+
+    explicit GameDatabase(MappedFile file) : file(std::move(file)) {}
+};
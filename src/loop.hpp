@@ -164,6 +164,13 @@ struct Event_MouseButtonDown {
     i32 x;
     i32 y;
 };
+struct Event_KeyDown {
+    u32 timestamp;
+    u32 windowID;
+    i32 key;
+    u16 modifiers;
+    u8 repeat;
+};
 struct Event_EventsCleared {};
 struct Event_LoopExiting {};
 
@@ -185,7 +192,8 @@ struct Event : Enum<
     Event_LoopExiting,
     Event_MouseMotion,
     Event_MouseButtonUp,
-    Event_MouseButtonDown
+    Event_MouseButtonDown,
+    Event_KeyDown
 > {
     using Quit = Event_Quit;
     using RequestRedraw = Event_RequestRedraw;
@@ -193,6 +201,7 @@ struct Event : Enum<
     using MouseMotion = Event_MouseMotion;
     using MouseButtonUp = Event_MouseButtonUp;
     using MouseButtonDown = Event_MouseButtonDown;
+    using KeyDown = Event_KeyDown;
     using LoopExiting = Event_LoopExiting;
 
     using Enum::Enum;
@@ -308,6 +317,15 @@ struct EventLoop {
                     event.button.y,
                 };
             }
+            case SDL_KEYDOWN: {
+                return Event::KeyDown{
+                    event.key.timestamp,
+                    event.key.windowID,
+                    event.key.keysym.sym,
+                    event.key.keysym.mod,
+                    event.key.repeat,
+                };
+            }
             case SDL_MOUSEMOTION: {
                 return Event::MouseMotion{
                     event.motion.timestamp,
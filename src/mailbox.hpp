@@ -0,0 +1,72 @@
+#pragma once
+
+// Single-producer, single-consumer slot holding only the latest value. Three
+// buffers rotate through an atomic index, so neither side ever waits: the
+// producer overwrites whatever the consumer has not picked up yet and the
+// consumer gets nothing until something new is published.
+template<typename T>
+struct Mailbox {
+    void publish(T const& value) {
+        slots[back] = value;
+        back = middle.exchange(u8(back | fresh), std::memory_order_acq_rel) & index_mask;
+    }
+
+    auto take() -> Option<T> {
+        if ((middle.load(std::memory_order_relaxed) & fresh) == 0) {
+            return None;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & index_mask;
+        return Some(T(slots[front]));
+    }
+
+private:
+    static constexpr u8 index_mask = 3;
+    static constexpr u8 fresh      = 4;
+
+    std::array<T, 3>    slots  = {};
+    u8                  back   = 0;
+    std::atomic_uint8_t middle = 1;
+    u8                  front  = 2;
+};
+
+// Bounded single-producer, single-consumer queue. Each side owns one index
+// and only reads the other's, refreshing its cached copy when it looks full
+// or empty, so neither side ever waits; a full queue refuses the value.
+template<typename T, size_t Capacity>
+struct RingQueue {
+    static_assert(std::has_single_bit(Capacity));
+
+    auto push(T const& value) -> bool {
+        auto tail = write.load(std::memory_order_relaxed);
+        if (tail - cached_read == Capacity) {
+            cached_read = read.load(std::memory_order_acquire);
+            if (tail - cached_read == Capacity) {
+                return false;
+            }
+        }
+        slots[tail & (Capacity - 1)] = value;
+        write.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    auto pop() -> Option<T> {
+        auto head = read.load(std::memory_order_relaxed);
+        if (head == cached_write) {
+            cached_write = write.load(std::memory_order_acquire);
+            if (head == cached_write) {
+                return None;
+            }
+        }
+        auto value = slots[head & (Capacity - 1)];
+        read.store(head + 1, std::memory_order_release);
+        return Some(T(value));
+    }
+
+private:
+    std::array<T, Capacity> slots = {};
+
+    alignas(64) std::atomic_size_t write        = 0; // producer
+    size_t                         cached_read  = 0;
+    alignas(64) std::atomic_size_t read         = 0; // consumer
+    size_t                         cached_write = 0;
+};
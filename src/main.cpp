@@ -1,20 +1,18 @@
 #include "loop.hpp"
 #include "math.hpp"
+#include "game.hpp"
+#include "notation.hpp"
+#include "search.hpp"
+#include "analysis.hpp"
+#include "net.hpp"
+
+#include <future>
+#include <charconv>
+#include <string_view>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-enum class State {
-    None,
-    White,
-    Black,
-};
-
-enum class Mode {
-    White,
-    Black,
-};
-
 struct Rect {
     f32 x0;
     f32 y0;
@@ -26,68 +24,330 @@ struct Rect {
     }
 };
 
+struct ServerAddress {
+    std::string host = {};
+    u16         port = {};
+};
+
+struct Options {
+    Option<Side>          engine  = None;
+    Option<Clock>         clock   = None;
+    Option<Position>      start   = None;
+    Option<ServerAddress> server  = None;
+    size_t                analyze = 0;
+};
+
+// The opponent plays through corners_server. Local moves are sent as they
+// are made; the server echoes every move to both players, so the echo of
+// the one in `sent` is skipped and only the opponent's are applied.
+struct RemotePlayer {
+    Socket        socket;
+    MessageReader reader    = {};
+    MessageWriter writer    = {};
+    Option<Side>  side      = None; // the side played here, once paired
+    Option<Move>  sent      = None; // played here, not yet echoed
+    bool          joining   = false;
+    bool          playing   = false;
+    bool          connected = true;
+};
+
+// The engine thinks on its own thread while the window keeps redrawing; its
+// answer is picked up by the first redraw after it is ready.
 struct GameState {
-    Handle<Texture>             board_texture   = {};
-    Handle<Texture>             black_texture   = {};
-    Handle<Texture>             white_texture   = {};
-    Handle<Texture>             select_texture  = {};
-    Option<i32vec2>             cell            = {};
-    Mode                        mode            = {};
-    Mode                        next            = {};
-    std::array<State, 8 * 8>    board           = {};
+    Handle<Texture>                      board_texture   = {};
+    Handle<Texture>                      black_texture   = {};
+    Handle<Texture>                      white_texture   = {};
+    Handle<Texture>                      select_texture  = {};
+    Option<i32vec2>                      cell            = {};
+    Game                                 game            = Game::new_();
+    Outcome                              outcome         = Outcome::None;
+    Option<std::array<Clock, 2>>         clocks          = None;
+    std::chrono::steady_clock::time_point turn_started   = {};
+    Option<Side>                         engine_side     = None;
+    std::unique_ptr<Engine>              engine          = {};
+    std::future<SearchResult>            thinking        = {};
+    std::unique_ptr<Analyzer>            analyzer        = {};
+    Option<AnalysisInfo>                 analysis        = None;
+    std::unique_ptr<RemotePlayer>        remote          = {};
+    std::string                          title           = {};
 };
 
-static auto id(i32 x, i32 y) -> i32 {
-    return x + y * 8;
+static auto loss(Side side) -> Outcome {
+    return side == Side::White ? Outcome::BlackWins : Outcome::WhiteWins;
 }
 
-static auto get_available_cells(std::array<State, 8 * 8>& board, i32vec2 where) -> std::set<i32vec2> {
-    std::set<i32vec2> cells = {};
+static auto time_left(GameState const& gs, Side side) -> std::chrono::milliseconds {
+    auto clock = (*gs.clocks)[size_t(side)];
+    if (side == gs.game.position.side && gs.outcome == Outcome::None) {
+        clock.remaining -= std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - gs.turn_started);
+    }
+    return clock.remaining;
+}
 
-    auto offsets = std::array{
-            i32vec2(-1, 0),
-            i32vec2(+1, 0),
-            i32vec2(0, +1),
-            i32vec2(0, -1),
-    };
+// Called after a move has been played: charges the clock of the side that
+// made it and checks whether the game is over.
+static void end_turn(GameState& gs) {
+    auto mover = ~gs.game.position.side;
+    auto now = std::chrono::steady_clock::now();
+    if (gs.clocks) {
+        auto& clock = (*gs.clocks)[size_t(mover)];
+        clock.remaining -= std::chrono::duration_cast<std::chrono::milliseconds>(now - gs.turn_started);
+        if (clock.remaining.count() < 0) {
+            gs.outcome = loss(mover);
+            return;
+        }
+        clock.remaining += clock.increment;
+    }
+    gs.turn_started = now;
+    if (gs.analyzer) {
+        gs.analyzer->set_position(gs.game.position);
+        gs.analysis = None;
+    }
+    gs.outcome = gs.game.outcome();
+}
 
-    auto is_available = [&board](i32vec2 const& cell) -> bool {
-        if (cell.x < 0 || cell.x >= 8) {
-            return false;
+// Starts a search when it is the engine's turn and plays its move once the
+// search is done. Without a clock the engine takes a second per move.
+static void update_engine(GameState& gs) {
+    if (!gs.engine_side || gs.outcome != Outcome::None || *gs.engine_side != gs.game.position.side) {
+        return;
+    }
+    if (!gs.thinking.valid()) {
+        auto limits = SearchLimits{.time = std::chrono::milliseconds(1000)};
+        if (gs.clocks) {
+            limits = SearchLimits{.clock = Some(Clock((*gs.clocks)[size_t(gs.game.position.side)]))};
         }
-        if (cell.y < 0 || cell.y >= 8) {
-            return false;
+#ifdef EMSCRIPTEN
+        auto policy = std::launch::deferred;
+#else
+        auto policy = std::launch::async;
+#endif
+        gs.thinking = std::async(policy, [engine = gs.engine.get(), position = gs.game.position, limits, ticket = gs.engine->ticket()]() {
+            return engine->search(position, limits, ticket);
+        });
+        return;
+    }
+    if (gs.thinking.wait_for(std::chrono::seconds(0)) == std::future_status::timeout) {
+        return;
+    }
+    auto result = gs.thinking.get();
+    if (!result.best || !gs.game.play(*result.best)) {
+        gs.outcome = loss(gs.game.position.side);
+        return;
+    }
+    end_turn(gs);
+}
+
+// Whether a click may move a piece now: neither the engine nor the remote
+// player is to move.
+static auto local_turn(GameState const& gs) -> bool {
+    auto side = gs.game.position.side;
+    if (gs.outcome != Outcome::None || (gs.engine_side && *gs.engine_side == side)) {
+        return false;
+    }
+    return !gs.remote || (gs.remote->playing && gs.remote->side && *gs.remote->side == side);
+}
+
+static void join_remote(GameState& gs) {
+    auto& remote = *gs.remote;
+    if (remote.connected && !remote.playing && !remote.joining && remote.writer.push(Message::join())) {
+        remote.side = None;
+        remote.joining = true;
+    }
+}
+
+// Applies whatever the server sent since the last redraw.
+static void update_remote(GameState& gs) {
+    auto& remote = *gs.remote;
+    if (!remote.connected) {
+        return;
+    }
+    auto fd = remote.socket.native_handle();
+    remote.connected = remote.writer.flush(fd) && remote.reader.read(fd, [&](Message const& message) {
+        switch (message.type) {
+            case MessageType::Start:
+                gs.game = Game::new_();
+                gs.cell = None;
+                gs.outcome = Outcome::None;
+                gs.turn_started = std::chrono::steady_clock::now();
+                if (gs.analyzer) {
+                    gs.analyzer->set_position(gs.game.position);
+                    gs.analysis = None;
+                }
+                remote.side = Some(Side(message.value));
+                remote.sent = None;
+                remote.joining = false;
+                remote.playing = true;
+                return true;
+            case MessageType::Moved:
+                if (remote.sent && *remote.sent == Move(message.from, message.to)) {
+                    remote.sent = None;
+                } else if (!gs.game.play(Move(message.from, message.to))) {
+                    return false;
+                } else {
+                    end_turn(gs);
+                }
+                gs.outcome = Outcome(message.value);
+                remote.playing = gs.outcome == Outcome::None;
+                return true;
+            case MessageType::Ended:
+                gs.outcome = Outcome(message.value);
+                remote.playing = false;
+                return true;
+            case MessageType::Rejected:
+                // Either the pending join, say when the server is full, or a
+                // move that was already played here.
+                if (remote.joining) {
+                    remote.joining = false;
+                } else if (remote.sent && gs.game.undo()) {
+                    remote.sent = None;
+                    gs.outcome = gs.game.outcome();
+                }
+                return true;
+            default: return false;
         }
-        return board[id(cell.x, cell.y)] == State::None;
-    };
+    });
+}
 
-    for (auto& offset : offsets) {
-        if (is_available(where + offset)) {
-            cells.emplace(where + offset);
+// Takes back or replays moves until it is a human's turn again, so undo
+// against the engine skips over its reply. A search in flight is dropped.
+static void step_history(GameState& gs, bool forward) {
+    if (gs.thinking.valid()) {
+        gs.engine->stop();
+        gs.thinking = {};
+    }
+    auto stepped = false;
+    while (forward ? gs.game.redo() : gs.game.undo()) {
+        stepped = true;
+        if (!(gs.engine_side && *gs.engine_side == gs.game.position.side)) {
+            break;
         }
     }
+    if (!stepped) {
+        return;
+    }
+    gs.cell = None;
+    gs.outcome = gs.game.outcome();
+    gs.turn_started = std::chrono::steady_clock::now();
+    if (gs.analyzer) {
+        gs.analyzer->set_position(gs.game.position);
+        gs.analysis = None;
+    }
+}
 
-    std::set<i32vec2> view = {};
-    std::deque<i32vec2> queue = {};
-    queue.emplace_back(where);
-    while (!queue.empty()) {
-        auto node = queue.front();
-        queue.pop_front();
+static auto format_clock(std::chrono::milliseconds time) -> std::string {
+    auto ms = std::max<i64>(time.count(), 0);
+    return fmt::format("{}:{:04.1f}", ms / 60000, f64(ms % 60000) / 1000.0);
+}
 
-        if (view.contains(node)) {
-            continue;
+static auto make_title(GameState const& gs) -> std::string {
+    auto title = std::string("Corners");
+    if (gs.remote) {
+        if (!gs.remote->connected) {
+            title += " - disconnected";
+        } else if (gs.remote->joining) {
+            title += " - waiting for an opponent";
+        } else if (!gs.remote->side) {
+            title += " - join refused, press Enter to retry";
+        } else {
+            title += *gs.remote->side == Side::White ? " - playing White" : " - playing Black";
         }
+    }
+    if (gs.analysis && gs.outcome == Outcome::None) {
+        auto const& info = *gs.analysis;
+        auto score = gs.game.position.side == Side::White ? info.score : -info.score;
+        title += fmt::format(" - depth {} score {:+}", info.depth, score);
+        for (u32 i = 0; i < std::min(info.length, 6U); ++i) {
+            title += " " + Notation::move(info.line[i]);
+        }
+    }
+    if (gs.clocks) {
+        auto white = time_left(gs, Side::White);
+        auto black = time_left(gs, Side::Black);
+        title += fmt::format(" - White {} | Black {}", format_clock(white), format_clock(black));
+    }
+    switch (gs.outcome) {
+        case Outcome::WhiteWins: return title + " - White wins";
+        case Outcome::BlackWins: return title + " - Black wins";
+        case Outcome::Draw: return title + " - Draw";
+        case Outcome::None: return title;
+    }
+    return title;
+}
+
+static auto parse_seconds(std::string_view text) -> Option<std::chrono::milliseconds> {
+    f64 value = {};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size() || value < 0.0) {
+        return None;
+    }
+    return Some(std::chrono::milliseconds(i64(value * 1000.0)));
+}
 
-        for (auto& offset : offsets) {
-            if (!is_available(node + offset) && is_available(node + offset * 2)) {
-                cells.emplace(node + offset * 2);
-                queue.emplace_back(node + offset * 2);
+static auto parse_args(i32 argc, const char* argv[]) -> Option<Options> {
+    auto options = Options{};
+    if (argc % 2 == 0) {
+        return None;
+    }
+    for (i32 i = 1; i + 1 < argc; i += 2) {
+        auto arg = std::string_view(argv[i]);
+        auto value = std::string_view(argv[i + 1]);
+        if (arg == "--analyze") {
+            auto megabytes = i32{};
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), megabytes);
+            if (ec != std::errc() || ptr != value.data() + value.size() || megabytes <= 0) {
+                return None;
             }
+            options.analyze = size_t(megabytes);
+            continue;
         }
-
-        view.emplace(node);
+        if (arg == "--fen") {
+            options.start = Notation::from_fen(value);
+            if (!options.start) {
+                return None;
+            }
+            continue;
+        }
+        if (arg == "--server") {
+            auto colon = value.rfind(':');
+            auto port = u16{};
+            auto digits = value.substr(colon == std::string_view::npos ? value.size() : colon + 1);
+            auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), port);
+            if (colon == std::string_view::npos || ec != std::errc() || ptr != digits.data() + digits.size()) {
+                return None;
+            }
+            options.server = ServerAddress{.host = std::string(value.substr(0, colon)), .port = port};
+            continue;
+        }
+        if (arg == "--engine") {
+            if (value == "white") {
+                options.engine = Side::White;
+            } else if (value == "black") {
+                options.engine = Side::Black;
+            } else {
+                return None;
+            }
+            continue;
+        }
+        auto seconds = parse_seconds(value);
+        if (!seconds) {
+            return None;
+        }
+        auto clock = options.clock.unwrap_or(Clock{});
+        if (arg == "--clock") {
+            clock.remaining = *seconds;
+        } else if (arg == "--inc") {
+            clock.increment = *seconds;
+        } else {
+            return None;
+        }
+        options.clock = Some(Clock(clock));
+    }
+    // The server keeps no clocks and pairs people, not engines.
+    if (options.server && (options.engine || options.clock)) {
+        return None;
     }
-    return cells;
+    return Some(Options(options));
 }
 
 static auto draw_sprite(Renderer& renderer, GpuTexture const& texture, f32 x, f32 y, f32 w, f32 h) {
@@ -95,29 +355,23 @@ static auto draw_sprite(Renderer& renderer, GpuTexture const& texture, f32 x, f3
     SDL_RenderCopy(renderer.native_handle(), texture.native_handle, nullptr, &rect);
 }
 
-static void init_board(GameState& gs) {
-    gs.board[id(0, 0)] = State::Black;
-    gs.board[id(0, 1)] = State::Black;
-    gs.board[id(0, 2)] = State::Black;
-    gs.board[id(1, 0)] = State::Black;
-    gs.board[id(1, 1)] = State::Black;
-    gs.board[id(1, 2)] = State::Black;
-    gs.board[id(2, 0)] = State::Black;
-    gs.board[id(2, 1)] = State::Black;
-    gs.board[id(2, 2)] = State::Black;
-
-    gs.board[id(5, 5)] = State::White;
-    gs.board[id(5, 6)] = State::White;
-    gs.board[id(5, 7)] = State::White;
-    gs.board[id(6, 5)] = State::White;
-    gs.board[id(6, 6)] = State::White;
-    gs.board[id(6, 7)] = State::White;
-    gs.board[id(7, 5)] = State::White;
-    gs.board[id(7, 6)] = State::White;
-    gs.board[id(7, 7)] = State::White;
-}
-
 auto main(i32 argc, const char* argv[]) -> i32 {
+    auto options = parse_args(argc, argv);
+    if (!options) {
+        fmt::print(
+            "usage: game [options]\n"
+            "  --engine white|black   let the engine play this side\n"
+            "  --clock SECONDS        play on a clock with this much time per side\n"
+            "  --inc SECONDS          clock increment per move (0)\n"
+            "  --analyze MB           search the board continuously with this much hash\n"
+            "  --fen \"FEN\"            start from this position instead of the initial one\n"
+            "  --server HOST:PORT     play against whoever corners_server pairs us with\n"
+            "left/right arrow keys take back and replay moves\n"
+            "against a server, Enter asks for the next game once one is over\n"
+        );
+        return 1;
+    }
+
     SDL_Init(SDL_INIT_VIDEO);
 
     auto event_loop = EventLoop::new_();
@@ -129,19 +383,42 @@ auto main(i32 argc, const char* argv[]) -> i32 {
     auto renderer = Renderer::new_(window);
     auto asset_manager = AssetManager::new_();
 
-    auto gs = GameState {
-        .mode = Mode::White,
-        .next = Mode::Black,
-    };
+    auto gs = GameState{};
     gs.board_texture = asset_manager.textures.add(Texture("assets/board.png"), renderer);
     gs.black_texture = asset_manager.textures.add(Texture("assets/black.png"), renderer);
     gs.white_texture = asset_manager.textures.add(Texture("assets/white.png"), renderer);
     gs.select_texture = asset_manager.textures.add(Texture("assets/select.png"), renderer);
 
-    init_board(gs);
+    if (options->start) {
+        gs.game = Game::from_position(*options->start);
+    }
+    gs.engine_side = options->engine;
+    if (gs.engine_side) {
+        gs.engine = std::make_unique<Engine>(64);
+    }
+    if (options->clock) {
+        gs.clocks = std::array{*options->clock, *options->clock};
+    }
+    gs.turn_started = std::chrono::steady_clock::now();
+    if (options->server) {
+        auto socket = Socket::connect(options->server->host.c_str(), options->server->port);
+        if (!socket) {
+            fmt::print(stderr, "failed to connect to {}:{}\n", options->server->host, options->server->port);
+            return 1;
+        }
+        gs.remote = std::make_unique<RemotePlayer>(RemotePlayer{.socket = std::move(socket).unwrap()});
+        join_remote(gs);
+    }
+
+#ifndef EMSCRIPTEN
+    if (options->analyze != 0) {
+        gs.analyzer = std::make_unique<Analyzer>(options->analyze);
+        gs.analyzer->set_position(gs.game.position);
+    }
+#endif
     event_loop.run([
         mouse_pressed = false,
-        gs = gs,
+        gs = std::move(gs),
         window = std::move(window),
         renderer = std::move(renderer),
         asset_manager = std::move(asset_manager)
@@ -154,10 +431,41 @@ auto main(i32 argc, const char* argv[]) -> i32 {
             case_(Event::MouseButtonDown const&) {
                 mouse_pressed = true;
             },
+            case_(Event::KeyDown const& key) {
+                if (gs.remote) {
+                    if (key.key == SDLK_RETURN) {
+                        join_remote(gs);
+                    }
+                } else if (key.key == SDLK_LEFT || key.key == SDLK_RIGHT) {
+                    step_history(gs, key.key == SDLK_RIGHT);
+                }
+            },
             case_(Event::EventsCleared const&) {},
             case_(Event::RequestRedraw const&) {
                 static constexpr auto cell_size = 450.0F / 8.0F;
 
+                auto side = gs.game.position.side;
+                if (gs.clocks && gs.outcome == Outcome::None && time_left(gs, side).count() < 0) {
+                    gs.outcome = loss(side);
+                    if (gs.engine) {
+                        gs.engine->stop();
+                    }
+                }
+                if (gs.remote) {
+                    update_remote(gs);
+                }
+                update_engine(gs);
+                if (gs.analyzer) {
+                    if (auto info = gs.analyzer->poll()) {
+                        gs.analysis = info;
+                    }
+                }
+                if (auto title = make_title(gs); title != gs.title) {
+                    gs.title = std::move(title);
+                    SDL_SetWindowTitle(window.native_handle(), gs.title.c_str());
+                }
+                auto human_turn = local_turn(gs);
+
                 SDL_SetRenderDrawColor(renderer.native_handle(), 0xFF, 0xFF, 0xFF, 0xFF);
                 SDL_RenderClear(renderer.native_handle());
 
@@ -172,54 +480,53 @@ auto main(i32 argc, const char* argv[]) -> i32 {
                         auto px = cell_size * f32(x);
                         auto py = cell_size * f32(y);
                         auto rect = Rect(px, py, px + cell_size, py + cell_size);
-                        auto press = mouse_pressed && rect.contains(f32(mouse_x), f32(mouse_y));
-
-                        switch (gs.board[id(x, y)]) {
-                            case State::None: {
-                                if (gs.cell && press) {
-                                    auto cells = gs.cell.map([&](auto& it) {
-                                        return get_available_cells(gs.board, it);
-                                    });
-
-                                    if (cells->contains(i32vec2(x, y))) {
-                                        std::swap(gs.board[id(x, y)], gs.board[id(gs.cell->x, gs.cell->y)]);
-                                        gs.cell = None;
-                                        gs.mode = gs.next;
+                        auto press = mouse_pressed && human_turn && rect.contains(f32(mouse_x), f32(mouse_y));
+
+                        auto square = x + y * 8;
+                        auto piece = gs.game.piece_at(square);
+                        if (!piece) {
+                            if (gs.cell && press) {
+                                auto from = gs.cell->x + gs.cell->y * 8;
+                                if (gs.game.play(Move(u8(from), u8(square)))) {
+                                    if (gs.remote) {
+                                        gs.remote->writer.push(Message::move(Move(u8(from), u8(square))));
+                                        gs.remote->sent = Some(Move(u8(from), u8(square)));
                                     }
+                                    gs.cell = None;
+                                    end_turn(gs);
                                 }
-                                break;
-                            }
-                            case State::Black: {
-                                if (press && (gs.mode == Mode::Black)) {
-                                    gs.cell = i32vec2(x, y);
-                                    gs.next = Mode::White;
-                                }
-                                if (gs.cell && (*gs.cell == i32vec2(x, y))) {
-                                    draw_sprite(renderer, asset_manager.textures.get(gs.select_texture), px, py, cell_size, cell_size);
-                                }
-                                draw_sprite(renderer, asset_manager.textures.get(gs.black_texture), px, py, cell_size, cell_size);
-                                break;
-                            }
-                            case State::White: {
-                                if (press && (gs.mode == Mode::White)) {
-                                    gs.cell = i32vec2(x, y);
-                                    gs.next = Mode::Black;
-                                }
-                                if (gs.cell && (*gs.cell == i32vec2(x, y))) {
-                                    draw_sprite(renderer, asset_manager.textures.get(gs.select_texture), px, py, cell_size, cell_size);
-                                }
-                                draw_sprite(renderer, asset_manager.textures.get(gs.white_texture), px, py, cell_size, cell_size);
-                                break;
                             }
+                            continue;
                         }
+                        if (press && *piece == gs.game.position.side) {
+                            gs.cell = i32vec2(x, y);
+                        }
+                        if (gs.cell && (*gs.cell == i32vec2(x, y))) {
+                            draw_sprite(renderer, asset_manager.textures.get(gs.select_texture), px, py, cell_size, cell_size);
+                        }
+                        auto texture = *piece == Side::White ? gs.white_texture : gs.black_texture;
+                        draw_sprite(renderer, asset_manager.textures.get(texture), px, py, cell_size, cell_size);
                     }
                 }
 
+                if (gs.analysis && gs.analysis->length != 0 && gs.outcome == Outcome::None) {
+                    auto to = i32(gs.analysis->line[0].to);
+                    auto px = cell_size * f32(to % 8);
+                    auto py = cell_size * f32(to / 8);
+                    draw_sprite(renderer, asset_manager.textures.get(gs.select_texture), px, py, cell_size, cell_size);
+                }
+
                 SDL_RenderPresent(renderer.native_handle());
 
                 mouse_pressed = false;
             },
-            case_(Event::LoopExiting const&) {},
+            case_(Event::LoopExiting const&) {
+                gs.analyzer.reset();
+                if (gs.thinking.valid()) {
+                    gs.engine->stop();
+                    gs.thinking.wait();
+                }
+            },
             case_(auto&) {}
         };
     });
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <utility>
+
+// A whole file mapped shared into memory, so writes land on disk without
+// explicit I/O and the working set can exceed RAM.
+struct MappedFile {
+    // Opens `path` read-write, growing or creating it to `size` bytes.
+    static auto create(char const* path, size_t size) -> Option<MappedFile> {
+        auto fd = ::open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            return None;
+        }
+        if (::ftruncate(fd, off_t(size)) != 0) {
+            ::close(fd);
+            return None;
+        }
+        return map(fd, size, PROT_READ | PROT_WRITE);
+    }
+
+    static auto open(char const* path) -> Option<MappedFile> {
+        auto fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return None;
+        }
+        auto size = ::lseek(fd, 0, SEEK_END);
+        if (size < 0) {
+            ::close(fd);
+            return None;
+        }
+        return map(fd, size_t(size), PROT_READ);
+    }
+
+    MappedFile(MappedFile&& other) noexcept
+        : ptr(std::exchange(other.ptr, nullptr))
+        , length(std::exchange(other.length, 0)) {}
+
+    auto operator=(MappedFile&& other) noexcept -> MappedFile& {
+        std::swap(ptr, other.ptr);
+        std::swap(length, other.length);
+        return *this;
+    }
+
+    ~MappedFile() {
+        if (ptr != nullptr) {
+            ::munmap(ptr, length);
+        }
+    }
+
+    [[nodiscard]] auto data() const -> u8* {
+        return static_cast<u8*>(ptr);
+    }
+
+    [[nodiscard]] auto size() const -> size_t {
+        return length;
+    }
+
+    auto sync() const -> bool {
+        return ptr == nullptr || ::msync(ptr, length, MS_SYNC) == 0;
+    }
+
+private:
+    void*  ptr    = nullptr;
+    size_t length = {};
+
+    MappedFile(void* ptr, size_t length) : ptr(ptr), length(length) {}
+
+    // Empty files cannot be mapped, but are still valid.
+    static auto map(i32 fd, size_t size, i32 protection) -> Option<MappedFile> {
+        auto ptr = size == 0 ? nullptr : ::mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED) {
+            return None;
+        }
+        return Some(MappedFile(ptr, size));
+    }
+};
@@ -0,0 +1,523 @@
+#include "search.hpp"
+#include "mcts.hpp"
+#include "dataset.hpp"
+#include "records.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <string_view>
+
+struct PlayerConfig {
+    std::string                    name        = {};
+    SearchLimits                   limits      = SearchLimits{.depth = 64, .nodes = 20000};
+    Option<std::string>            nnue        = None;
+    Option<std::string>            eval        = None;
+    std::unique_ptr<Network>       network     = {};
+    EvalParams                     params      = EvalParams::new_();
+    Option<SolverConfig>           solver      = None;
+    Option<BestFirstConfig>        best_first  = None;
+    Option<std::string>            mcts        = None;
+    MctsConfig                     mcts_config = {};
+    std::unique_ptr<PolicyNetwork> policy      = {};
+};
+
+struct MatchConfig {
+    u64                        games        = 1000;
+    u32                        threads      = std::max(1U, std::thread::hardware_concurrency());
+    u32                        random_plies = 0;
+    u64                        seed         = 1;
+    size_t                     tt_megabytes = 16;
+    Option<std::array<f64, 4>> sprt         = None; // elo0, elo1, alpha, beta
+    Option<std::string>        record       = None;
+    Option<std::string>        archive      = None;
+    Option<std::string>        stats        = None;
+    std::array<PlayerConfig, 2> players     = {PlayerConfig{.name = "A"}, PlayerConfig{.name = "B"}};
+};
+
+struct Tally {
+    u64 wins   = {};
+    u64 draws  = {};
+    u64 losses = {};
+
+    [[nodiscard]] auto games() const -> u64 {
+        return wins + draws + losses;
+    }
+
+    // An empty tally scores an even 0.5 with no spread.
+    [[nodiscard]] auto score() const -> f64 {
+        if (games() == 0) {
+            return 0.5;
+        }
+        return (f64(wins) + 0.5 * f64(draws)) / f64(games());
+    }
+
+    [[nodiscard]] auto variance() const -> f64 {
+        if (games() == 0) {
+            return 0.0;
+        }
+        auto n = f64(games());
+        auto s = score();
+        auto w = f64(wins) / n;
+        auto d = f64(draws) / n;
+        auto l = f64(losses) / n;
+        return w * (1.0 - s) * (1.0 - s) + d * (0.5 - s) * (0.5 - s) + l * s * s;
+    }
+};
+
+struct Elo {
+    static auto from_score(f64 score) -> f64 {
+        score = std::clamp(score, 1e-6, 1.0 - 1e-6);
+        return -400.0 * std::log10(1.0 / score - 1.0);
+    }
+
+    static auto to_score(f64 elo) -> f64 {
+        return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+    }
+
+    // 95% interval of the mean score mapped back to Elo.
+    static auto error(Tally const& tally) -> f64 {
+        if (tally.games() == 0) {
+            return 0.0;
+        }
+        auto margin = 1.96 * std::sqrt(tally.variance() / f64(tally.games()));
+        return (from_score(tally.score() + margin) - from_score(tally.score() - margin)) * 0.5;
+    }
+
+    // Normal approximation of the trinomial log-likelihood ratio.
+    static auto llr(Tally const& tally, f64 elo0, f64 elo1) -> f64 {
+        auto variance = tally.variance();
+        if (tally.games() == 0 || variance <= 0.0) {
+            return 0.0;
+        }
+        auto s0 = to_score(elo0);
+        auto s1 = to_score(elo1);
+        return f64(tally.games()) * (s1 - s0) * (2.0 * tally.score() - s0 - s1) / (2.0 * variance);
+    }
+};
+
+static auto parse_u64(std::string_view text) -> Option<u64> {
+    u64 value = {};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        return None;
+    }
+    return Some(u64(value));
+}
+
+static auto parse_f64(std::string_view text) -> Option<f64> {
+    auto owned = std::string(text);
+    char* end = nullptr;
+    auto value = std::strtod(owned.c_str(), &end);
+    if (end != owned.c_str() + owned.size()) {
+        return None;
+    }
+    return Some(f64(value));
+}
+
+static void print_usage() {
+    fmt::print(
+        "usage: corners_match [options]\n"
+        "  --games N             total games, played in colour-swapped pairs (1000)\n"
+        "  --threads N           worker threads, one game each (all cores)\n"
+        "  --random-plies N      random opening moves before the engines take over (0)\n"
+        "  --seed N              opening seed (1)\n"
+        "  --hash MB             transposition table per engine (16)\n"
+        "  --sprt E0 E1 A B      stop early once H0: elo=E0 or H1: elo=E1 is accepted\n"
+        "  --record FILE         append every played position and its result to FILE\n"
+        "  --archive FILE        append every game to FILE as a binary game record\n"
+        "  --stats FILE          write per-engine search statistics to FILE as JSON\n"
+        "  --{{a,b}}-name NAME     player name stored in the archive (A, B)\n"
+        "  --{{a,b}}-depth N       search depth limit\n"
+        "  --{{a,b}}-nodes N       search node limit (20000)\n"
+        "  --{{a,b}}-time-ms N     search time limit per move\n"
+        "  --{{a,b}}-clock-ms N    play on a clock with this much time per game\n"
+        "  --{{a,b}}-inc-ms N      clock increment per move (0)\n"
+        "  --{{a,b}}-nnue FILE     evaluate with the network in FILE\n"
+        "  --{{a,b}}-params FILE   evaluation parameters written by corners_tune\n"
+        "  --{{a,b}}-solver MB     try to prove late-game wins first with this much solver memory\n"
+        "  --{{a,b}}-ubfm MB       search best-first instead of alpha-beta, keeping at most MB of nodes\n"
+        "  --{{a,b}}-mcts FILE     play batched MCTS guided by the policy/value network in FILE\n"
+        "  --{{a,b}}-mcts-threads N  MCTS threads, also the inference batch size (16)\n"
+    );
+}
+
+static auto parse_args(i32 argc, const char* argv[]) -> Option<MatchConfig> {
+    auto config = MatchConfig{};
+    for (i32 i = 1; i < argc; ++i) {
+        auto arg = std::string_view(argv[i]);
+        auto next = [&]() -> Option<std::string_view> {
+            if (i + 1 >= argc) {
+                return None;
+            }
+            return Some(std::string_view(argv[++i]));
+        };
+        auto next_u64 = [&]() -> Option<u64> {
+            auto value = next();
+            return value ? parse_u64(*value) : Option<u64>(None);
+        };
+
+        if (arg == "--sprt") {
+            std::array<f64, 4> values = {};
+            for (auto& value : values) {
+                auto text = next();
+                auto parsed = text ? parse_f64(*text) : Option<f64>(None);
+                if (!parsed) {
+                    return None;
+                }
+                value = *parsed;
+            }
+            config.sprt = Some(std::array<f64, 4>(values));
+            continue;
+        }
+        if (arg == "--record" || arg == "--archive" || arg == "--stats") {
+            auto path = next();
+            if (!path) {
+                return None;
+            }
+            (arg == "--record" ? config.record : arg == "--archive" ? config.archive : config.stats) = Some(std::string(*path));
+            continue;
+        }
+        if (arg == "--a-name" || arg == "--b-name") {
+            auto name = next();
+            if (!name) {
+                return None;
+            }
+            config.players[arg[2] == 'a' ? 0 : 1].name = std::string(*name);
+            continue;
+        }
+        if (arg == "--a-nnue" || arg == "--b-nnue") {
+            auto path = next();
+            if (!path) {
+                return None;
+            }
+            config.players[arg[2] == 'a' ? 0 : 1].nnue = Some(std::string(*path));
+            continue;
+        }
+        if (arg == "--a-params" || arg == "--b-params") {
+            auto path = next();
+            if (!path) {
+                return None;
+            }
+            config.players[arg[2] == 'a' ? 0 : 1].eval = Some(std::string(*path));
+            continue;
+        }
+        if (arg == "--a-mcts" || arg == "--b-mcts") {
+            auto path = next();
+            if (!path) {
+                return None;
+            }
+            config.players[arg[2] == 'a' ? 0 : 1].mcts = Some(std::string(*path));
+            continue;
+        }
+
+        auto value = next_u64();
+        if (!value) {
+            return None;
+        }
+        if (arg == "--games") {
+            config.games = *value;
+        } else if (arg == "--threads") {
+            config.threads = std::max<u32>(1, u32(*value));
+        } else if (arg == "--random-plies") {
+            config.random_plies = u32(*value);
+        } else if (arg == "--seed") {
+            config.seed = *value;
+        } else if (arg == "--hash") {
+            config.tt_megabytes = size_t(*value);
+        } else if (arg.size() > 4 && arg.starts_with("--") && (arg[2] == 'a' || arg[2] == 'b') && arg[3] == '-') {
+            auto& player = config.players[arg[2] == 'a' ? 0 : 1];
+            auto& limits = player.limits;
+            auto option = arg.substr(4);
+            if (option == "ubfm") {
+                player.best_first = Some(BestFirstConfig{.max_nodes = (*value << 20) / sizeof(TranspositionTable::Entry)});
+            } else if (option == "solver") {
+                player.solver = Some(SolverConfig{.limits = ProofLimits{.arena_bytes = size_t(*value) << 20}});
+            } else if (option == "mcts-threads") {
+                player.mcts_config.threads = std::max<u32>(1, u32(*value));
+                player.mcts_config.batch = player.mcts_config.threads;
+            } else if (option == "depth") {
+                limits.depth = i32(*value);
+            } else if (option == "nodes") {
+                limits.nodes = *value;
+            } else if (option == "time-ms") {
+                limits.time = std::chrono::milliseconds(*value);
+            } else if (option == "clock-ms" || option == "inc-ms") {
+                auto clock = limits.clock.unwrap_or(Clock{});
+                (option == "clock-ms" ? clock.remaining : clock.increment) = std::chrono::milliseconds(*value);
+                limits.clock = Some(Clock(clock));
+            } else {
+                return None;
+            }
+        } else {
+            return None;
+        }
+    }
+    return Some(std::move(config));
+}
+
+// Random openings are shared by both games of a pair so colour bias cancels
+// out. The opening moves are left in `moves` for the game record.
+static auto make_opening(MatchConfig const& config, u64 pair, std::vector<Move>& moves) -> Position {
+    auto position = Position::new_();
+    moves.clear();
+    auto rng = std::mt19937_64(config.seed * 0x9E3779B97F4A7C15ULL + pair);
+    for (u32 i = 0; i < config.random_plies; ++i) {
+        MoveList list;
+        position.generate_moves(list);
+        if (list.size == 0) {
+            break;
+        }
+        auto move = list[u32(rng() % list.size)];
+        auto next = position;
+        next.make_move(move);
+        if (next.outcome() != Outcome::None) {
+            break;
+        }
+        position = next;
+        moves.push_back(move);
+    }
+    return position;
+}
+
+// `limits` carries each side's starting clock; a side whose clock runs out
+// loses. Played moves are appended to `moves`.
+static auto play_game(std::array<Engine*, 2> engines, std::array<Mcts*, 2> trees, std::array<SearchLimits, 2> limits, Position position, std::vector<Position>& history, std::vector<Move>& moves, std::array<SearchStats, 2>& stats) -> Outcome {
+    history.clear();
+    while (true) {
+        auto outcome = position.outcome();
+        if (outcome != Outcome::None) {
+            return outcome;
+        }
+        history.push_back(position);
+        auto index = position.side == Side::White ? 0 : 1;
+        auto loss = position.side == Side::White ? Outcome::BlackWins : Outcome::WhiteWins;
+        auto started = std::chrono::steady_clock::now();
+        auto result = SearchResult{};
+        if (trees[index] != nullptr) {
+            result = trees[index]->search(position, limits[index]);
+            stats[index].merge(trees[index]->stats());
+        } else {
+            result = engines[index]->search(position, limits[index]);
+            stats[index].merge(engines[index]->stats());
+        }
+        if (!result.best) {
+            return loss;
+        }
+        if (auto& clock = limits[index].clock) {
+            clock->remaining -= std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+            if (clock->remaining.count() < 0) {
+                return loss;
+            }
+            clock->remaining += clock->increment;
+        }
+        moves.push_back(*result.best);
+        position.make_move(*result.best);
+    }
+}
+
+auto main(i32 argc, const char* argv[]) -> i32 {
+    auto parsed = parse_args(argc, argv);
+    if (!parsed) {
+        print_usage();
+        return 1;
+    }
+    auto config = std::move(parsed).unwrap();
+
+    for (auto& player : config.players) {
+        if (player.nnue) {
+            auto network = Network::load(player.nnue->c_str());
+            if (!network) {
+                fmt::print(stderr, "failed to load network '{}'\n", *player.nnue);
+                return 1;
+            }
+            player.network = std::move(network).unwrap();
+        }
+        if (player.eval) {
+            auto params = EvalParams::load(player.eval->c_str());
+            if (!params) {
+                fmt::print(stderr, "failed to load parameters '{}'\n", *player.eval);
+                return 1;
+            }
+            player.params = *params;
+        }
+        if (player.mcts) {
+            auto policy = PolicyNetwork::load(player.mcts->c_str());
+            if (!policy) {
+                fmt::print(stderr, "failed to load policy network '{}'\n", *player.mcts);
+                return 1;
+            }
+            player.policy = std::move(policy).unwrap();
+        }
+    }
+
+    auto writer = Option<SampleWriter>(None);
+    if (config.record) {
+        auto opened = SampleWriter::open(config.record->c_str(), true);
+        if (!opened) {
+            fmt::print(stderr, "failed to open '{}'\n", *config.record);
+            return 1;
+        }
+        writer = std::move(opened);
+    }
+    auto archive = Option<GameRecordWriter>(None);
+    if (config.archive) {
+        auto opened = GameRecordWriter::open(config.archive->c_str());
+        if (!opened) {
+            fmt::print(stderr, "failed to open '{}'\n", *config.archive);
+            return 1;
+        }
+        archive = std::move(opened);
+    }
+
+    auto mutex = std::mutex{};
+    auto tally = Tally{};
+    auto next_game = std::atomic_uint64_t{0};
+    auto finished = std::atomic_bool{false};
+    auto started = std::chrono::steady_clock::now();
+    auto worker_stats = std::vector<std::array<SearchStats, 2>>(config.threads);
+
+    auto merged_stats = [&]() -> std::array<SearchStats, 2> {
+        std::array<SearchStats, 2> merged = {};
+        for (auto& slot : worker_stats) {
+            merged[0].merge(slot[0]);
+            merged[1].merge(slot[1]);
+        }
+        return merged;
+    };
+
+    auto report = [&](Tally const& snapshot) {
+        auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+        auto line = fmt::format(
+            "games {} +{} ={} -{} elo {:+.1f} +/- {:.1f} ({:.0f} games/h)",
+            snapshot.games(), snapshot.wins, snapshot.draws, snapshot.losses,
+            Elo::from_score(snapshot.score()), Elo::error(snapshot),
+            f64(snapshot.games()) * 3600.0 / std::max(seconds, 1e-9)
+        );
+        auto stats = merged_stats();
+        line += fmt::format(" knps {:.0f}/{:.0f}", stats[0].nodes_per_second() / 1000.0, stats[1].nodes_per_second() / 1000.0);
+        if (config.sprt) {
+            auto& [elo0, elo1, alpha, beta] = *config.sprt;
+            line += fmt::format(
+                " llr {:.2f} [{:.2f}, {:.2f}]",
+                Elo::llr(snapshot, elo0, elo1), std::log(beta / (1.0 - alpha)), std::log((1.0 - beta) / alpha)
+            );
+        }
+        fmt::print("{}\n", line);
+        std::fflush(stdout);
+    };
+
+    auto worker = [&](u32 id) {
+        std::array<std::unique_ptr<Engine>, 2> engines;
+        std::array<std::unique_ptr<Mcts>, 2> trees;
+        for (u32 i = 0; i < 2; ++i) {
+            if (config.players[i].policy) {
+                trees[i] = std::make_unique<Mcts>(*config.players[i].policy, config.players[i].mcts_config);
+            }
+            engines[i] = std::make_unique<Engine>(config.tt_megabytes);
+            engines[i]->network = config.players[i].network.get();
+            engines[i]->params = config.players[i].params;
+            engines[i]->solver = config.players[i].solver;
+            engines[i]->best_first = config.players[i].best_first;
+        }
+
+        std::vector<Position> history;
+        std::vector<Move> moves;
+        std::vector<Sample> samples;
+
+        while (!finished.load(std::memory_order_relaxed)) {
+            auto game = next_game.fetch_add(1, std::memory_order_relaxed);
+            if (game >= config.games) {
+                break;
+            }
+
+            // Engine A is White in even games and Black in odd ones.
+            auto a_is_white = (game % 2) == 0;
+            auto white = a_is_white ? 0 : 1;
+            auto black = a_is_white ? 1 : 0;
+            for (auto& engine : engines) {
+                engine->tt.clear();
+            }
+            std::array<SearchStats, 2> game_stats = {};
+            auto opening = make_opening(config, game / 2, moves);
+            auto outcome = play_game(
+                {engines[white].get(), engines[black].get()},
+                {trees[white].get(), trees[black].get()},
+                {config.players[white].limits, config.players[black].limits},
+                opening,
+                history,
+                moves,
+                game_stats
+            );
+
+            if (writer) {
+                samples.clear();
+                for (auto& position : history) {
+                    samples.push_back(Sample::new_(position, outcome));
+                }
+            }
+
+            auto lock = std::lock_guard(mutex);
+            if (writer) {
+                writer->write(samples);
+            }
+            if (archive) {
+                auto header = GameHeader::new_(Position::new_(), config.players[white].name, config.players[black].name, outcome);
+                auto clock = config.players[white].limits.clock.unwrap_or(Clock{});
+                header.base_ms = u32(clock.remaining.count());
+                header.increment_ms = u32(clock.increment.count());
+                archive->write(header, moves);
+            }
+            worker_stats[id][white].merge(game_stats[0]);
+            worker_stats[id][black].merge(game_stats[1]);
+            if (outcome == Outcome::Draw) {
+                tally.draws += 1;
+            } else if ((outcome == Outcome::WhiteWins) == a_is_white) {
+                tally.wins += 1;
+            } else {
+                tally.losses += 1;
+            }
+
+            if (tally.games() % std::max<u64>(config.threads, 16) == 0) {
+                report(tally);
+            }
+            if (config.sprt) {
+                auto& [elo0, elo1, alpha, beta] = *config.sprt;
+                auto llr = Elo::llr(tally, elo0, elo1);
+                if (llr <= std::log(beta / (1.0 - alpha)) || llr >= std::log((1.0 - beta) / alpha)) {
+                    finished.store(true, std::memory_order_relaxed);
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (u32 i = 0; i < config.threads; ++i) {
+        threads.emplace_back(worker, i);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    report(tally);
+    if (config.stats) {
+        auto stats = merged_stats();
+        auto file = File(std::fopen(config.stats->c_str(), "wb"));
+        if (file == nullptr) {
+            fmt::print(stderr, "failed to write '{}'\n", *config.stats);
+            return 1;
+        }
+        fmt::print(file.get(), "{{\"a\":{},\"b\":{}}}\n", stats[0].to_json(), stats[1].to_json());
+    }
+    if (config.sprt) {
+        auto& [elo0, elo1, alpha, beta] = *config.sprt;
+        auto llr = Elo::llr(tally, elo0, elo1);
+        if (llr >= std::log((1.0 - beta) / alpha)) {
+            fmt::print("sprt: H1 accepted\n");
+        } else if (llr <= std::log(beta / (1.0 - alpha))) {
+            fmt::print("sprt: H0 accepted\n");
+        } else {
+            fmt::print("sprt: inconclusive\n");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "search.hpp"
+#include "policy.hpp"
+
+struct MctsConfig {
+    u32                       threads       = 16;
+    u32                       batch         = 16;
+    std::chrono::microseconds batch_timeout = std::chrono::microseconds(500);
+    f32                       cpuct         = 1.5F;
+    size_t                    megabytes     = 64;
+};
+
+// `value` is seen from the side that made `move`, so a parent picks the child
+// with the highest value. Children are a contiguous run in the arena and are
+// published by `state` turning Expanded.
+struct MctsNode {
+    enum : u8 {
+        Leaf,
+        Expanding,
+        Expanded,
+    };
+
+    std::atomic<f32>     value    = 0.0F;
+    std::atomic_uint32_t visits   = 0;
+    u32                  children = 0;
+    u16                  count    = 0;
+    Move                 move     = {};
+    f32                  prior    = 0.0F;
+    std::atomic_uint8_t  state    = Leaf;
+};
+
+// PUCT search in the AlphaZero style. Every thread walks the shared tree with
+// a virtual loss on its path, so concurrent walks spread out, and parks at a
+// new leaf until the inference queue has evaluated it together with the
+// leaves of the other threads. Nodes come from a fixed arena; the search
+// stops when the arena is full.
+struct Mcts {
+    MctsConfig config;
+
+    Mcts(PolicyNetwork const& network, MctsConfig const& config)
+        : config(config)
+        , capacity(std::max<size_t>((config.megabytes << 20) / sizeof(MctsNode), 1024))
+        , nodes(std::make_unique<MctsNode[]>(capacity))
+        , queue(network, config.batch, config.batch_timeout) {}
+
+    void stop() {
+        stopped.store(true, std::memory_order_relaxed);
+    }
+
+    auto stats() const -> SearchStats {
+        auto lock = std::lock_guard(published_mutex);
+        return published;
+    }
+
+    [[nodiscard]] auto average_batch() const -> f64 {
+        return queue.average_batch();
+    }
+
+    // `limits.nodes` counts playouts and `limits.depth` is ignored.
+    auto search(Position const& root, SearchLimits const& limits) -> SearchResult {
+        this->limits = limits;
+        if (limits.clock) {
+            this->limits.time = std::min(this->limits.time, TimeManager::new_(*limits.clock, root.ply).optimum);
+        }
+        started = std::chrono::steady_clock::now();
+        stopped.store(false, std::memory_order_relaxed);
+        playouts.store(0, std::memory_order_relaxed);
+        used.store(1, std::memory_order_relaxed);
+        reset(nodes[0], Move{}, 1.0F);
+
+        auto result = SearchResult{};
+        if (root.outcome() != Outcome::None || !expand(0, root, queue.evaluate(root))) {
+            publish();
+            return result;
+        }
+
+        std::vector<std::thread> threads;
+        for (u32 i = 1; i < config.threads; ++i) {
+            threads.emplace_back([&]() { run(root); });
+        }
+        run(root);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        auto& parent = nodes[0];
+        auto best = parent.children;
+        for (u32 i = parent.children; i < parent.children + parent.count; ++i) {
+            if (nodes[i].visits.load(std::memory_order_relaxed) > nodes[best].visits.load(std::memory_order_relaxed)) {
+                best = i;
+            }
+        }
+        auto visits = std::max(1U, nodes[best].visits.load(std::memory_order_relaxed));
+        auto q = std::clamp(nodes[best].value.load(std::memory_order_relaxed) / f32(visits), -0.999F, 0.999F);
+        result.best = Some(Move(nodes[best].move));
+        result.score = i32(std::atanh(q) * 400.0F);
+        result.nodes = playouts.load(std::memory_order_relaxed);
+        publish();
+        return result;
+    }
+
+private:
+    size_t                                capacity;
+    std::unique_ptr<MctsNode[]>           nodes;
+    InferenceQueue                        queue;
+    SearchLimits                          limits    = {};
+    std::chrono::steady_clock::time_point started   = {};
+    std::atomic_bool                      stopped   = {};
+    std::atomic_uint64_t                  playouts  = 0;
+    std::atomic_size_t                    used      = 0;
+    mutable std::mutex                    published_mutex;
+    SearchStats                           published = {};
+
+    static void reset(MctsNode& node, Move move, f32 prior) {
+        node.value.store(0.0F, std::memory_order_relaxed);
+        node.visits.store(0, std::memory_order_relaxed);
+        node.children = 0;
+        node.count = 0;
+        node.move = move;
+        node.prior = prior;
+        node.state.store(MctsNode::Leaf, std::memory_order_relaxed);
+    }
+
+    void publish() {
+        auto elapsed = std::chrono::steady_clock::now() - started;
+        auto lock = std::lock_guard(published_mutex);
+        published = SearchStats{
+            .searches = 1,
+            .nodes = playouts.load(std::memory_order_relaxed),
+            .micros = u64(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()),
+        };
+    }
+
+    // Priors are the policy softmax restricted to legal moves. False when
+    // there are no moves or the arena cannot hold the children.
+    auto expand(u32 index, Position const& position, Inference const& inference) -> bool {
+        MoveList list;
+        position.generate_moves(list);
+        auto first = used.fetch_add(list.size, std::memory_order_relaxed);
+        if (list.size == 0 || first + list.size > capacity) {
+            return false;
+        }
+
+        std::array<f32, 512> priors;
+        auto highest = -std::numeric_limits<f32>::infinity();
+        for (u32 i = 0; i < list.size; ++i) {
+            priors[i] = inference.logit(position.side, list[i]);
+            highest = std::max(highest, priors[i]);
+        }
+        auto sum = 0.0F;
+        for (u32 i = 0; i < list.size; ++i) {
+            priors[i] = std::exp(priors[i] - highest);
+            sum += priors[i];
+        }
+        for (u32 i = 0; i < list.size; ++i) {
+            reset(nodes[first + i], list[i], priors[i] / sum);
+        }
+
+        auto& node = nodes[index];
+        node.children = u32(first);
+        node.count = u16(list.size);
+        node.state.store(MctsNode::Expanded, std::memory_order_release);
+        return true;
+    }
+
+    auto select(u32 index) const -> u32 {
+        auto& node = nodes[index];
+        auto parent_visits = f32(node.visits.load(std::memory_order_relaxed));
+        auto exploration = config.cpuct * std::sqrt(std::max(parent_visits, 1.0F));
+        auto best = node.children;
+        auto best_score = -std::numeric_limits<f32>::infinity();
+        for (u32 i = node.children; i < node.children + node.count; ++i) {
+            auto& child = nodes[i];
+            auto visits = f32(child.visits.load(std::memory_order_relaxed));
+            auto q = visits == 0.0F ? 0.0F : child.value.load(std::memory_order_relaxed) / visits;
+            auto score = q + exploration * child.prior / (1.0F + visits);
+            if (score > best_score) {
+                best_score = score;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    auto done() const -> bool {
+        if (stopped.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        if (playouts.load(std::memory_order_relaxed) >= limits.nodes) {
+            return true;
+        }
+        return limits.time != std::chrono::milliseconds::max() && std::chrono::steady_clock::now() - started >= limits.time;
+    }
+
+    // Virtual loss: a visit scored as a loss for the mover while the walk is in
+    // flight, replaced by the real value on the way back.
+    static void apply_virtual_loss(MctsNode& node) {
+        node.visits.fetch_add(1, std::memory_order_relaxed);
+        node.value.fetch_sub(1.0F, std::memory_order_relaxed);
+    }
+
+    void run(Position const& root) {
+        std::vector<u32> path;
+        while (!done()) {
+            path.clear();
+            path.push_back(0);
+            nodes[0].visits.fetch_add(1, std::memory_order_relaxed);
+
+            auto position = root;
+            auto index = u32(0);
+            while (nodes[index].state.load(std::memory_order_acquire) == MctsNode::Expanded) {
+                index = select(index);
+                apply_virtual_loss(nodes[index]);
+                position.make_move(nodes[index].move);
+                path.push_back(index);
+            }
+
+            // `value` is for the side to move at the leaf.
+            auto value = 0.0F;
+            auto outcome = position.outcome();
+            if (outcome != Outcome::None) {
+                value = outcome == Outcome::Draw ? 0.0F : Score::from_outcome(outcome, position.side, 0) > 0 ? 1.0F : -1.0F;
+            } else {
+                auto expected = u8(MctsNode::Leaf);
+                if (!nodes[index].state.compare_exchange_strong(expected, MctsNode::Expanding, std::memory_order_acquire)) {
+                    // Another thread is expanding this leaf; take the walk back.
+                    backpropagate(path, 0.0F, false);
+                    std::this_thread::yield();
+                    continue;
+                }
+                auto inference = queue.evaluate(position);
+                value = inference.value;
+                if (!expand(index, position, inference)) {
+                    MoveList list;
+                    position.generate_moves(list);
+                    if (list.size == 0) {
+                        value = -1.0F;
+                    } else {
+                        stop();
+                    }
+                    nodes[index].state.store(MctsNode::Leaf, std::memory_order_release);
+                }
+            }
+            backpropagate(path, value, true);
+            playouts.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Walks from the leaf to the root; the leaf was reached by the opponent
+    // of the side to move there, so the sign starts negative.
+    void backpropagate(std::span<u32 const> path, f32 value, bool counted) {
+        auto sign = -1.0F;
+        for (size_t i = path.size(); i-- > 1;) {
+            auto& node = nodes[path[i]];
+            if (counted) {
+                node.value.fetch_add(sign * value + 1.0F, std::memory_order_relaxed);
+            } else {
+                node.visits.fetch_sub(1, std::memory_order_relaxed);
+                node.value.fetch_add(1.0F, std::memory_order_relaxed);
+            }
+            sign = -sign;
+        }
+        if (!counted) {
+            nodes[0].visits.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+};
@@ -0,0 +1,264 @@
+#pragma once
+
+#include "position.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <utility>
+
+// Every message in either direction is one 8-byte frame, so a reader only
+// ever buffers a partial frame and never parses a length. Fields are in host
+// byte order: the server and its clients share a machine.
+enum class MessageType : u8 {
+    Join,     // client: pair me with the next player who joins
+    Move,     // client: play `from`-`to` in my current game
+    Resign,   // client: give up my current game
+    Start,    // server: `game` started and you play side `value`
+    Moved,    // server: `from`-`to` was played in `game`, `value` is the outcome after it
+    Ended,    // server: `game` was resigned or abandoned, `value` is the outcome
+    Rejected, // server: the last request was refused
+    List,     // client: list up to `value` games in play
+    Watch,    // client: follow `game` as a spectator
+    Listed,   // server: `game` is in play; `game` = no_game ends the list
+    Watching, // server: now following `game`; `value` is the side to move, `from` | `to` << 8 the ply
+    Board,    // server: after Watching, four of these carry white and black, 32 bits each in `game`
+};
+
+static constexpr u32 no_game = ~u32(0);
+
+struct Message {
+    MessageType type  = {};
+    u8          value = {};
+    u8          from  = {};
+    u8          to    = {};
+    u32         game  = {};
+
+    static auto join() -> Message {
+        return Message{.type = MessageType::Join};
+    }
+
+    static auto move(Move move) -> Message {
+        return Message{.type = MessageType::Move, .from = move.from, .to = move.to};
+    }
+
+    static auto resign() -> Message {
+        return Message{.type = MessageType::Resign};
+    }
+
+    static auto start(u32 game, Side side) -> Message {
+        return Message{.type = MessageType::Start, .value = u8(side), .game = game};
+    }
+
+    static auto moved(u32 game, Move move, Outcome outcome) -> Message {
+        return Message{.type = MessageType::Moved, .value = u8(outcome), .from = move.from, .to = move.to, .game = game};
+    }
+
+    static auto ended(u32 game, Outcome outcome) -> Message {
+        return Message{.type = MessageType::Ended, .value = u8(outcome), .game = game};
+    }
+
+    static auto rejected() -> Message {
+        return Message{.type = MessageType::Rejected};
+    }
+
+    static auto list(u8 limit) -> Message {
+        return Message{.type = MessageType::List, .value = limit};
+    }
+
+    static auto watch(u32 game) -> Message {
+        return Message{.type = MessageType::Watch, .game = game};
+    }
+
+    static auto listed(u32 game) -> Message {
+        return Message{.type = MessageType::Listed, .game = game};
+    }
+
+    static auto watching(u32 game, Position const& position) -> Message {
+        return Message{.type = MessageType::Watching, .value = u8(position.side), .from = u8(position.ply), .to = u8(position.ply >> 8), .game = game};
+    }
+
+    static auto board(u8 part, u32 bits) -> Message {
+        return Message{.type = MessageType::Board, .value = part, .game = bits};
+    }
+};
+
+static_assert(sizeof(Message) == 8);
+
+// A non-blocking TCP socket with Nagle's algorithm off, as every message is
+// a single small frame that should leave at once.
+struct Socket {
+    static auto listen(u16 port, bool reuse_port) -> Option<Socket> {
+        auto socket = Socket(::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+        if (socket.fd < 0) {
+            return None;
+        }
+        auto one = i32(1);
+        ::setsockopt(socket.fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (reuse_port && ::setsockopt(socket.fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+            return None;
+        }
+        auto address = sockaddr_in{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (::bind(socket.fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            return None;
+        }
+        if (::listen(socket.fd, SOMAXCONN) != 0) {
+            return None;
+        }
+        return Some(std::move(socket));
+    }
+
+    // Connects synchronously, then switches the socket to non-blocking.
+    static auto connect(char const* host, u16 port) -> Option<Socket> {
+        auto hints = addrinfo{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* found = nullptr;
+        if (::getaddrinfo(host, std::to_string(port).c_str(), &hints, &found) != 0) {
+            return None;
+        }
+        auto socket = Socket(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+        auto connected = socket.fd >= 0 && ::connect(socket.fd, found->ai_addr, found->ai_addrlen) == 0;
+        ::freeaddrinfo(found);
+        if (!connected) {
+            return None;
+        }
+        ::fcntl(socket.fd, F_SETFL, ::fcntl(socket.fd, F_GETFL) | O_NONBLOCK);
+        socket.set_nodelay();
+        return Some(std::move(socket));
+    }
+
+    // Takes the next pending connection off a listening socket.
+    auto accept() const -> Option<Socket> {
+        auto socket = Socket(::accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC));
+        if (socket.fd < 0) {
+            return None;
+        }
+        socket.set_nodelay();
+        return Some(std::move(socket));
+    }
+
+    Socket(Socket&& other) noexcept : fd(std::exchange(other.fd, -1)) {}
+
+    auto operator=(Socket&& other) noexcept -> Socket& {
+        std::swap(fd, other.fd);
+        return *this;
+    }
+
+    ~Socket() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    [[nodiscard]] auto native_handle() const -> i32 {
+        return fd;
+    }
+
+private:
+    i32 fd = -1;
+
+    explicit Socket(i32 fd) : fd(fd) {}
+
+    void set_nodelay() const {
+        auto one = i32(1);
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+};
+
+// Reassembles frames from a non-blocking socket across partial reads.
+struct MessageReader {
+    // Reads until the socket is drained and hands every complete message to
+    // `visit`, which returns false to stop. False if the peer closed, the
+    // read failed or `visit` refused a message.
+    template<typename Visit>
+    auto read(i32 fd, Visit&& visit) -> bool {
+        std::array<u8, 4096> buffer;
+        while (true) {
+            std::memcpy(buffer.data(), partial.data(), partial_size);
+            auto got = ::recv(fd, buffer.data() + partial_size, buffer.size() - partial_size, 0);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            if (got == 0) {
+                return false;
+            }
+            auto size = partial_size + size_t(got);
+            auto whole = size - size % sizeof(Message);
+            for (size_t offset = 0; offset < whole; offset += sizeof(Message)) {
+                auto message = Message{};
+                std::memcpy(&message, buffer.data() + offset, sizeof(message));
+                if (!visit(message)) {
+                    return false;
+                }
+            }
+            partial_size = size - whole;
+            std::memcpy(partial.data(), buffer.data() + whole, partial_size);
+            if (size < buffer.size()) {
+                return true;
+            }
+        }
+    }
+
+private:
+    std::array<u8, sizeof(Message)> partial      = {};
+    size_t                          partial_size = 0;
+};
+
+// Messages waiting to be sent. The capacity is fixed so a connection costs
+// the same whatever its peer does; a peer that stops reading fills it up
+// and is dropped instead of growing the server.
+struct MessageWriter {
+    static constexpr size_t capacity = 64;
+
+    // False if the buffer is full.
+    auto push(Message const& message) -> bool {
+        if (size + sizeof(Message) > pending.size()) {
+            return false;
+        }
+        std::memcpy(pending.data() + size, &message, sizeof(Message));
+        size += sizeof(Message);
+        return true;
+    }
+
+    // Sends as much as the socket takes. False if the send failed.
+    auto flush(i32 fd) -> bool {
+        auto sent = size_t(0);
+        while (sent < size) {
+            auto written = ::send(fd, pending.data() + sent, size - sent, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    return false;
+                }
+                break;
+            }
+            sent += size_t(written);
+        }
+        std::memmove(pending.data(), pending.data() + sent, size - sent);
+        size -= sent;
+        return true;
+    }
+
+    [[nodiscard]] auto empty() const -> bool {
+        return size == 0;
+    }
+
+private:
+    std::array<u8, capacity * sizeof(Message)> pending = {};
+    size_t                                     size    = 0;
+};
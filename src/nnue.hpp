@@ -0,0 +1,208 @@
+#pragma once
+
+#include "file.hpp"
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+// Feature index is (relative color, square) seen from one perspective.
+// Black's perspective is rotated by 180 degrees so both sides race towards square 0.
+struct NnueLayout {
+    static constexpr i32 inputs = 2 * 64;
+    static constexpr i32 hidden = 64;
+    static constexpr i32 l1     = 16;
+    static constexpr i32 scale  = 64;
+    static constexpr u32 magic  = 0x554E4E43; // "CNNU"
+    static constexpr u32 version = 1;
+
+    static constexpr auto feature(u32 perspective, u32 side, i32 square) -> i32 {
+        auto relative = u32(side != perspective);
+        auto oriented = perspective == 0 ? square : 63 - square;
+        return i32(relative) * 64 + oriented;
+    }
+};
+
+struct alignas(32) Accumulator {
+    std::array<std::array<i16, NnueLayout::hidden>, 2> values = {};
+};
+
+struct alignas(32) Network {
+    std::array<std::array<i16, NnueLayout::hidden>, NnueLayout::inputs> ft_weights = {};
+    std::array<i16, NnueLayout::hidden>                                  ft_bias    = {};
+    std::array<std::array<i8, 2 * NnueLayout::hidden>, NnueLayout::l1>   l1_weights = {};
+    std::array<i32, NnueLayout::l1>                                      l1_bias    = {};
+    std::array<i8, NnueLayout::l1>                                       out_weights = {};
+    i32                                                                  out_bias   = {};
+
+    // File layout: magic, version, then every array above in declaration order, little endian.
+    static auto load(char const* path) -> Option<std::unique_ptr<Network>> {
+        auto file = File(std::fopen(path, "rb"));
+        if (file == nullptr) {
+            return None;
+        }
+
+        auto read = [&](void* dst, size_t size) -> bool {
+            return std::fread(dst, 1, size, file.get()) == size;
+        };
+
+        u32 magic;
+        u32 version;
+        if (!read(&magic, sizeof(magic)) || magic != NnueLayout::magic) {
+            return None;
+        }
+        if (!read(&version, sizeof(version)) || version != NnueLayout::version) {
+            return None;
+        }
+
+        auto network = std::make_unique<Network>();
+        auto ok = read(network->ft_weights.data(), sizeof(network->ft_weights))
+            && read(network->ft_bias.data(), sizeof(network->ft_bias))
+            && read(network->l1_weights.data(), sizeof(network->l1_weights))
+            && read(network->l1_bias.data(), sizeof(network->l1_bias))
+            && read(network->out_weights.data(), sizeof(network->out_weights))
+            && read(&network->out_bias, sizeof(network->out_bias));
+        if (!ok) {
+            return None;
+        }
+        return Some(std::move(network));
+    }
+
+    // Full rebuild from piece sets, used at the root and after unrelated jumps in the tree.
+    void refresh(Accumulator& acc, u64 white, u64 black) const {
+        for (u32 perspective = 0; perspective < 2; ++perspective) {
+            acc.values[perspective] = ft_bias;
+            for (u32 side = 0; side < 2; ++side) {
+                for (auto bits = side == 0 ? white : black; bits != 0; bits &= bits - 1) {
+                    auto square = std::countr_zero(bits);
+                    add(acc.values[perspective], ft_weights[NnueLayout::feature(perspective, side, square)]);
+                }
+            }
+        }
+    }
+
+    void move_piece(Accumulator& acc, u32 side, i32 from, i32 to) const {
+        for (u32 perspective = 0; perspective < 2; ++perspective) {
+            sub(acc.values[perspective], ft_weights[NnueLayout::feature(perspective, side, from)]);
+            add(acc.values[perspective], ft_weights[NnueLayout::feature(perspective, side, to)]);
+        }
+    }
+
+    // Score in centi-units from the point of view of `side_to_move`.
+    [[nodiscard]] auto evaluate(Accumulator const& acc, u32 side_to_move) const -> i32 {
+        alignas(32) std::array<u8, 2 * NnueLayout::hidden> input;
+        clamp_i16(input.data(), acc.values[side_to_move].data());
+        clamp_i16(input.data() + NnueLayout::hidden, acc.values[side_to_move ^ 1].data());
+
+        auto output = out_bias;
+        for (i32 i = 0; i < NnueLayout::l1; ++i) {
+            auto sum = l1_bias[i] + dot_u8_i8(input.data(), l1_weights[i].data());
+            auto hidden = std::clamp(sum >> 6, 0, 127);
+            output += hidden * out_weights[i];
+        }
+        return output / NnueLayout::scale;
+    }
+
+private:
+    using Column = std::array<i16, NnueLayout::hidden>;
+
+    static void add(Column& dst, Column const& src) {
+#if defined(__AVX2__)
+        for (i32 i = 0; i < NnueLayout::hidden; i += 16) {
+            auto a = _mm256_load_si256(reinterpret_cast<__m256i const*>(dst.data() + i));
+            auto b = _mm256_load_si256(reinterpret_cast<__m256i const*>(src.data() + i));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(dst.data() + i), _mm256_add_epi16(a, b));
+        }
+#elif defined(__SSSE3__)
+        for (i32 i = 0; i < NnueLayout::hidden; i += 8) {
+            auto a = _mm_load_si128(reinterpret_cast<__m128i const*>(dst.data() + i));
+            auto b = _mm_load_si128(reinterpret_cast<__m128i const*>(src.data() + i));
+            _mm_store_si128(reinterpret_cast<__m128i*>(dst.data() + i), _mm_add_epi16(a, b));
+        }
+#else
+        for (i32 i = 0; i < NnueLayout::hidden; ++i) {
+            dst[i] = i16(dst[i] + src[i]);
+        }
+#endif
+    }
+
+    static void sub(Column& dst, Column const& src) {
+#if defined(__AVX2__)
+        for (i32 i = 0; i < NnueLayout::hidden; i += 16) {
+            auto a = _mm256_load_si256(reinterpret_cast<__m256i const*>(dst.data() + i));
+            auto b = _mm256_load_si256(reinterpret_cast<__m256i const*>(src.data() + i));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(dst.data() + i), _mm256_sub_epi16(a, b));
+        }
+#elif defined(__SSSE3__)
+        for (i32 i = 0; i < NnueLayout::hidden; i += 8) {
+            auto a = _mm_load_si128(reinterpret_cast<__m128i const*>(dst.data() + i));
+            auto b = _mm_load_si128(reinterpret_cast<__m128i const*>(src.data() + i));
+            _mm_store_si128(reinterpret_cast<__m128i*>(dst.data() + i), _mm_sub_epi16(a, b));
+        }
+#else
+        for (i32 i = 0; i < NnueLayout::hidden; ++i) {
+            dst[i] = i16(dst[i] - src[i]);
+        }
+#endif
+    }
+
+    static void clamp_i16(u8* dst, i16 const* src) {
+#if defined(__AVX2__)
+        for (i32 i = 0; i < NnueLayout::hidden; i += 32) {
+            auto a = _mm256_load_si256(reinterpret_cast<__m256i const*>(src + i));
+            auto b = _mm256_load_si256(reinterpret_cast<__m256i const*>(src + i + 16));
+            auto packed = _mm256_packs_epi16(a, b);
+            packed = _mm256_max_epi8(packed, _mm256_setzero_si256());
+            packed = _mm256_permute4x64_epi64(packed, 0b11011000);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+        }
+#elif defined(__SSSE3__)
+        for (i32 i = 0; i < NnueLayout::hidden; i += 16) {
+            auto a = _mm_load_si128(reinterpret_cast<__m128i const*>(src + i));
+            auto b = _mm_load_si128(reinterpret_cast<__m128i const*>(src + i + 8));
+            auto packed = _mm_packs_epi16(a, b);
+            auto mask = _mm_cmpgt_epi8(packed, _mm_setzero_si128());
+            _mm_store_si128(reinterpret_cast<__m128i*>(dst + i), _mm_and_si128(packed, mask));
+        }
+#else
+        for (i32 i = 0; i < NnueLayout::hidden; ++i) {
+            dst[i] = u8(std::clamp<i32>(src[i], 0, 127));
+        }
+#endif
+    }
+
+    static auto dot_u8_i8(u8 const* input, i8 const* weights) -> i32 {
+#if defined(__AVX2__)
+        auto ones = _mm256_set1_epi16(1);
+        auto sum = _mm256_setzero_si256();
+        for (i32 i = 0; i < 2 * NnueLayout::hidden; i += 32) {
+            auto a = _mm256_load_si256(reinterpret_cast<__m256i const*>(input + i));
+            auto b = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(weights + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(a, b), ones));
+        }
+        auto lo = _mm256_castsi256_si128(sum);
+        auto hi = _mm256_extracti128_si256(sum, 1);
+        auto r = _mm_add_epi32(lo, hi);
+        r = _mm_add_epi32(r, _mm_shuffle_epi32(r, 0b01001110));
+        r = _mm_add_epi32(r, _mm_shuffle_epi32(r, 0b10110001));
+        return _mm_cvtsi128_si32(r);
+#elif defined(__SSSE3__)
+        auto ones = _mm_set1_epi16(1);
+        auto sum = _mm_setzero_si128();
+        for (i32 i = 0; i < 2 * NnueLayout::hidden; i += 16) {
+            auto a = _mm_load_si128(reinterpret_cast<__m128i const*>(input + i));
+            auto b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(weights + i));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(a, b), ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b01001110));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b10110001));
+        return _mm_cvtsi128_si32(sum);
+#else
+        i32 sum = 0;
+        for (i32 i = 0; i < 2 * NnueLayout::hidden; ++i) {
+            sum += i32(input[i]) * i32(weights[i]);
+        }
+        return sum;
+#endif
+    }
+};
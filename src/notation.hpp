@@ -0,0 +1,115 @@
+#pragma once
+
+#include "position.hpp"
+
+#include <charconv>
+#include <string_view>
+
+// Squares are named like a chess board as main.cpp draws it: files a-h from
+// left to right and ranks 8-1 from top to bottom, so White starts on f1-h3.
+// A move is its two squares run together, e.g. "f3e3".
+//
+// Positions are written FEN style: ranks 8 to 1 separated by '/', 'W' and 'B'
+// for pieces and digits for runs of empty squares, then the side to move and
+// the ply, e.g. "BBB5/BBB5/BBB5/8/8/5WWW/5WWW/5WWW w 0" for the start.
+struct Notation {
+    static auto square(i32 square) -> std::string {
+        return fmt::format("{}{}", char('a' + square % 8), 8 - square / 8);
+    }
+
+    static auto parse_square(std::string_view text) -> Option<i32> {
+        if (text.size() != 2 || text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8') {
+            return None;
+        }
+        return Some(i32((text[0] - 'a') + ('8' - text[1]) * 8));
+    }
+
+    static auto move(Move move) -> std::string {
+        return square(move.from) + square(move.to);
+    }
+
+    static auto parse_move(std::string_view text) -> Option<Move> {
+        if (text.size() != 4) {
+            return None;
+        }
+        auto from = parse_square(text.substr(0, 2));
+        auto to = parse_square(text.substr(2, 2));
+        if (!from || !to) {
+            return None;
+        }
+        return Some(Move(u8(*from), u8(*to)));
+    }
+
+    static auto to_fen(Position const& position) -> std::string {
+        std::string fen;
+        for (i32 y = 0; y < 8; ++y) {
+            auto empty = 0;
+            for (i32 x = 0; x < 8; ++x) {
+                auto bit = Bitboard::bit(x + y * 8);
+                auto piece = (position.white & bit) != 0 ? 'W' : (position.black & bit) != 0 ? 'B' : '\0';
+                if (piece == '\0') {
+                    empty += 1;
+                    continue;
+                }
+                if (empty != 0) {
+                    fen.push_back(char('0' + empty));
+                    empty = 0;
+                }
+                fen.push_back(piece);
+            }
+            if (empty != 0) {
+                fen.push_back(char('0' + empty));
+            }
+            fen.push_back(y == 7 ? ' ' : '/');
+        }
+        fen += fmt::format("{} {}", position.side == Side::White ? 'w' : 'b', position.ply);
+        return fen;
+    }
+
+    static auto from_fen(std::string_view text) -> Option<Position> {
+        u64 white = 0;
+        u64 black = 0;
+        i32 x = 0;
+        i32 y = 0;
+        size_t i = 0;
+        for (; i < text.size() && text[i] != ' '; ++i) {
+            auto c = text[i];
+            if (c == '/') {
+                if (x != 8 || ++y == 8) {
+                    return None;
+                }
+                x = 0;
+            } else if (c >= '1' && c <= '8') {
+                x += c - '0';
+            } else if ((c == 'W' || c == 'B') && x < 8) {
+                (c == 'W' ? white : black) |= Bitboard::bit(x + y * 8);
+                x += 1;
+            } else {
+                return None;
+            }
+            if (x > 8) {
+                return None;
+            }
+        }
+        if (x != 8 || y != 7 || i + 3 > text.size() || text[i + 2] != ' ') {
+            return None;
+        }
+        if (text[i + 1] != 'w' && text[i + 1] != 'b') {
+            return None;
+        }
+        // Packed positions give each piece one colour bit in 32; no real
+        // game comes close, but a made-up board could silently lose colours.
+        if (std::popcount(white | black) > 32) {
+            return None;
+        }
+        auto side = text[i + 1] == 'w' ? Side::White : Side::Black;
+
+        auto digits = text.substr(i + 3);
+        u16 ply = 0;
+        auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), ply);
+        if (digits.empty() || ec != std::errc() || ptr != digits.data() + digits.size()) {
+            return None;
+        }
+        return Some(Position::from_bitboards(white, black, side, ply));
+    }
+};
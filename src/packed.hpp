@@ -0,0 +1,37 @@
+#pragma once
+
+#include "position.hpp"
+
+// A position in 16 bytes, for archives, books and the wire. Two full
+// bitboards would leave no room for the side and ply, so only the occupancy
+// is stored whole; `colours` holds one bit per occupied square in ascending
+// order, set for Black. Eighteen pieces fit easily in 32 bits; boards with
+// more than 32 are refused by Notation::from_fen. Training samples keep
+// both bitboards, as the tuner reads them once per epoch for every sample.
+struct PackedPosition {
+    u64 occupied = {};
+    u32 colours  = {};
+    u16 ply      = {};
+    u8  side     = {};
+    u8  reserved = {};
+
+    static auto pack(Position const& position) -> PackedPosition {
+        auto occupied = position.occupied();
+        return PackedPosition{
+            .occupied = occupied,
+            .colours = u32(Bitboard::compress(position.black, occupied)),
+            .ply = position.ply,
+            .side = u8(position.side),
+            .reserved = 0,
+        };
+    }
+
+    [[nodiscard]] auto unpack() const -> Position {
+        auto black = Bitboard::expand(colours, occupied);
+        return Position::from_bitboards(occupied & ~black, black, Side(side & 1), ply);
+    }
+
+    friend constexpr auto operator==(PackedPosition const&, PackedPosition const&) noexcept -> bool = default;
+};
+
+static_assert(sizeof(PackedPosition) == 16);
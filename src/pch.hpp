@@ -1,11 +1,20 @@
 #pragma once
 
 #include <set>
+#include <bit>
 #include <deque>
+#include <span>
 #include <array>
 #include <mutex>
+#include <cmath>
+#include <limits>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <atomic>
 #include <vector>
 #include <memory>
+#include <algorithm>
 #include <numbers>
 #include <variant>
 #include <unordered_map>
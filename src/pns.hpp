@@ -0,0 +1,217 @@
+#pragma once
+
+#include "position.hpp"
+
+enum class Proof : u8 {
+    Unknown,
+    Win,
+    NoWin,
+};
+
+struct ProofLimits {
+    size_t arena_bytes = 64 * 1024 * 1024;
+    u64    nodes       = std::numeric_limits<u64>::max();
+    i32    depth       = 64;
+};
+
+struct ProofResult {
+    Proof        value  = Proof::Unknown;
+    Option<Move> move   = None;
+    u64          nodes  = {};
+    u32          length = {}; // plies to the win along the proof tree
+};
+
+// Best-first proof-number search for a forced win of the side to move at the
+// root. Draws count as failure. The tree lives in a fixed arena; once it is
+// full the search stops and reports Unknown. Leaves at the depth limit are
+// treated as failures so the search moves on, which means a disproof that
+// met one of them only says Unknown.
+struct ProofNumberSearch {
+    static constexpr u32 infinity = std::numeric_limits<u32>::max() / 2;
+
+    auto prove(Position const& root, ProofLimits const& limits) -> ProofResult {
+        this->limits = limits;
+        this->attacker = root.side;
+        this->root_ply = root.ply;
+        this->depth_cut = false;
+
+        auto capacity = std::max<size_t>(limits.arena_bytes / sizeof(Node), 1);
+        nodes.clear();
+        nodes.reserve(capacity);
+        nodes.push_back(leaf(root, Move{}, 0));
+
+        u64 expanded = 0;
+        while (nodes[0].pn != 0 && nodes[0].dn != 0 && expanded < limits.nodes) {
+            auto index = select();
+            if (!expand(index, capacity)) {
+                break;
+            }
+            update(index);
+            expanded += 1;
+        }
+
+        auto result = ProofResult{.nodes = expanded};
+        if (nodes[0].pn == 0) {
+            result.value = Proof::Win;
+            result.length = proof_length(0);
+            for (u32 i = 0; i < nodes[0].children; ++i) {
+                auto& child = nodes[nodes[0].first_child + i];
+                if (child.pn == 0) {
+                    result.move = Some(Move(child.move));
+                    break;
+                }
+            }
+        } else if (nodes[0].dn == 0 && !depth_cut) {
+            result.value = Proof::NoWin;
+        }
+        nodes = {};
+        return result;
+    }
+
+private:
+    struct Node {
+        Position position    = {};
+        u32      parent      = {};
+        u32      first_child = {};
+        u32      pn          = {};
+        u32      dn          = {};
+        u16      children    = {};
+        bool     expanded    = {};
+        Move     move        = {};
+    };
+
+    ProofLimits       limits    = {};
+    Side              attacker  = {};
+    u16               root_ply  = {};
+    bool              depth_cut = {};
+    std::vector<Node> nodes     = {};
+
+    static auto saturating_add(u32 a, u32 b) -> u32 {
+        return std::min(a + b, infinity);
+    }
+
+    auto is_or(Node const& node) const -> bool {
+        return node.position.side == attacker;
+    }
+
+    auto leaf(Position const& position, Move move, u32 parent) -> Node {
+        // Pieces the attacker still has to bring home is a cheap estimate of proof effort.
+        auto outside = std::popcount(position.pieces(attacker) & ~Bitboard::target(attacker));
+        auto node = Node{
+            .position = position,
+            .parent = parent,
+            .first_child = 0,
+            .pn = u32(1 + outside),
+            .dn = 1,
+            .children = 0,
+            .expanded = false,
+            .move = move,
+        };
+
+        auto outcome = position.outcome();
+        if (outcome != Outcome::None) {
+            auto won = outcome == (attacker == Side::White ? Outcome::WhiteWins : Outcome::BlackWins);
+            node.pn = won ? 0 : infinity;
+            node.dn = won ? infinity : 0;
+            node.expanded = true;
+        } else if (i32(position.ply - root_ply) >= limits.depth) {
+            node.pn = infinity;
+            node.dn = 0;
+            node.expanded = true;
+            depth_cut = true;
+        }
+        return node;
+    }
+
+    // The attacker takes the shortest proven move, the defender the longest
+    // proven reply; proven leaves are won positions or a defender without moves.
+    auto proof_length(u32 index) const -> u32 {
+        auto& node = nodes[index];
+        if (node.children == 0) {
+            return 0;
+        }
+        auto length = is_or(node) ? std::numeric_limits<u32>::max() : 0U;
+        for (u32 i = 0; i < node.children; ++i) {
+            auto child = node.first_child + i;
+            if (nodes[child].pn != 0) {
+                continue;
+            }
+            auto plies = 1 + proof_length(child);
+            length = is_or(node) ? std::min(length, plies) : std::max(length, plies);
+        }
+        return length;
+    }
+
+    // Most-proving node: follow the child that determines the parent's number.
+    auto select() const -> u32 {
+        u32 index = 0;
+        while (nodes[index].expanded && nodes[index].children != 0) {
+            auto& node = nodes[index];
+            auto best = node.first_child;
+            for (u32 i = 1; i < node.children; ++i) {
+                auto& child = nodes[node.first_child + i];
+                auto& current = nodes[best];
+                if (is_or(node) ? child.pn < current.pn : child.dn < current.dn) {
+                    best = node.first_child + i;
+                }
+            }
+            index = best;
+        }
+        return index;
+    }
+
+    auto expand(u32 index, size_t capacity) -> bool {
+        MoveList list;
+        nodes[index].position.generate_moves(list);
+        if (nodes.size() + list.size > capacity) {
+            return false;
+        }
+
+        auto position = nodes[index].position;
+        nodes[index].expanded = true;
+        nodes[index].first_child = u32(nodes.size());
+        nodes[index].children = u16(list.size);
+        for (auto move : list) {
+            auto child = position;
+            child.make_move(move);
+            nodes.push_back(leaf(child, move, index));
+        }
+
+        // A side without moves loses.
+        if (list.size == 0) {
+            auto or_node = is_or(nodes[index]);
+            nodes[index].pn = or_node ? infinity : 0;
+            nodes[index].dn = or_node ? 0 : infinity;
+        }
+        return true;
+    }
+
+    void update(u32 index) {
+        while (true) {
+            auto& node = nodes[index];
+            if (node.children != 0) {
+                auto pn = is_or(node) ? infinity : 0;
+                auto dn = is_or(node) ? 0 : infinity;
+                for (u32 i = 0; i < node.children; ++i) {
+                    auto& child = nodes[node.first_child + i];
+                    if (is_or(node)) {
+                        pn = std::min(pn, child.pn);
+                        dn = saturating_add(dn, child.dn);
+                    } else {
+                        pn = saturating_add(pn, child.pn);
+                        dn = std::min(dn, child.dn);
+                    }
+                }
+                if (index != 0 && pn == node.pn && dn == node.dn) {
+                    return;
+                }
+                node.pn = pn;
+                node.dn = dn;
+            }
+            if (index == 0) {
+                return;
+            }
+            index = node.parent;
+        }
+    }
+};
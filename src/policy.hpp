@@ -0,0 +1,211 @@
+#pragma once
+
+#include "position.hpp"
+#include "nnue.hpp"
+
+#include <condition_variable>
+
+// Inputs are the mover's and the opponent's piece planes seen from the mover,
+// exactly as NNUE features, so both colours race towards square 0. The policy
+// head scores a move as from[from] + to[to] over the same oriented squares.
+struct PolicyLayout {
+    static constexpr i32 inputs  = NnueLayout::inputs;
+    static constexpr i32 hidden  = 128;
+    static constexpr i32 outputs = 2 * 64;
+    static constexpr u32 magic   = 0x4E565043; // "CPVN"
+    static constexpr u32 version = 1;
+};
+
+struct Inference {
+    f32                                    value  = {}; // for the side to move, in [-1, 1]
+    std::array<f32, PolicyLayout::outputs> logits = {};
+
+    [[nodiscard]] auto logit(Side side, Move move) const -> f32 {
+        auto from = side == Side::White ? i32(move.from) : 63 - i32(move.from);
+        auto to = side == Side::White ? i32(move.to) : 63 - i32(move.to);
+        return logits[from] + logits[64 + to];
+    }
+};
+
+struct PolicyNetwork {
+    std::array<std::array<f32, PolicyLayout::hidden>, PolicyLayout::inputs>  input_weights  = {};
+    std::array<f32, PolicyLayout::hidden>                                    input_bias     = {};
+    std::array<std::array<f32, PolicyLayout::outputs>, PolicyLayout::hidden> policy_weights = {};
+    std::array<f32, PolicyLayout::outputs>                                   policy_bias    = {};
+    std::array<f32, PolicyLayout::hidden>                                    value_weights  = {};
+    f32                                                                      value_bias     = {};
+
+    // File layout: magic, version, then every array above in declaration order as little endian f32.
+    static auto load(char const* path) -> Option<std::unique_ptr<PolicyNetwork>> {
+        auto file = File(std::fopen(path, "rb"));
+        if (file == nullptr) {
+            return None;
+        }
+
+        auto read = [&](void* dst, size_t size) -> bool {
+            return std::fread(dst, 1, size, file.get()) == size;
+        };
+
+        u32 magic;
+        u32 version;
+        if (!read(&magic, sizeof(magic)) || magic != PolicyLayout::magic) {
+            return None;
+        }
+        if (!read(&version, sizeof(version)) || version != PolicyLayout::version) {
+            return None;
+        }
+
+        auto network = std::make_unique<PolicyNetwork>();
+        auto ok = read(network->input_weights.data(), sizeof(network->input_weights))
+            && read(network->input_bias.data(), sizeof(network->input_bias))
+            && read(network->policy_weights.data(), sizeof(network->policy_weights))
+            && read(network->policy_bias.data(), sizeof(network->policy_bias))
+            && read(network->value_weights.data(), sizeof(network->value_weights))
+            && read(&network->value_bias, sizeof(network->value_bias));
+        if (!ok) {
+            return None;
+        }
+        return Some(std::move(network));
+    }
+
+    // The input layer is a sparse sum over the ~18 pieces. The dense policy
+    // layer walks its weight rows once for the whole batch, so each row is
+    // loaded from cache once per batch instead of once per position.
+    void evaluate_batch(std::span<Position const> positions, std::span<Inference> out) const {
+        static constexpr size_t chunk = 64;
+        static thread_local std::array<std::array<f32, PolicyLayout::hidden>, chunk> hidden;
+
+        for (size_t base = 0; base < positions.size(); base += chunk) {
+            auto count = std::min(chunk, positions.size() - base);
+            for (size_t b = 0; b < count; ++b) {
+                auto& position = positions[base + b];
+                auto perspective = u32(position.side);
+                hidden[b] = input_bias;
+                for (u32 side = 0; side < 2; ++side) {
+                    for (auto bits = side == 0 ? position.white : position.black; bits != 0; bits &= bits - 1) {
+                        auto& row = input_weights[NnueLayout::feature(perspective, side, std::countr_zero(bits))];
+                        for (i32 k = 0; k < PolicyLayout::hidden; ++k) {
+                            hidden[b][k] += row[k];
+                        }
+                    }
+                }
+
+                auto value = value_bias;
+                for (i32 k = 0; k < PolicyLayout::hidden; ++k) {
+                    hidden[b][k] = std::max(hidden[b][k], 0.0F);
+                    value += hidden[b][k] * value_weights[k];
+                }
+                out[base + b].value = std::tanh(value);
+                out[base + b].logits = policy_bias;
+            }
+
+            for (i32 k = 0; k < PolicyLayout::hidden; ++k) {
+                auto& row = policy_weights[k];
+                for (size_t b = 0; b < count; ++b) {
+                    auto h = hidden[b][k];
+                    if (h == 0.0F) {
+                        continue;
+                    }
+                    auto& logits = out[base + b].logits;
+                    for (i32 j = 0; j < PolicyLayout::outputs; ++j) {
+                        logits[j] += h * row[j];
+                    }
+                }
+            }
+        }
+    }
+};
+
+// Collects leaf evaluations from many search threads into one network call.
+// A batch is flushed as soon as it is full, or once its oldest request has
+// waited `timeout`, so a lone thread near the end of a search never stalls.
+struct InferenceQueue {
+    InferenceQueue(PolicyNetwork const& network, u32 batch, std::chrono::microseconds timeout)
+        : network(network), batch(std::max(1U, batch)), timeout(timeout) {
+        worker = std::thread([this]() { run(); });
+    }
+
+    InferenceQueue(InferenceQueue const&) = delete;
+    auto operator=(InferenceQueue const&) -> InferenceQueue& = delete;
+
+    ~InferenceQueue() {
+        {
+            auto lock = std::lock_guard(mutex);
+            quit = true;
+        }
+        arrived.notify_one();
+        worker.join();
+    }
+
+    // Blocks the calling thread until the batch holding its request has run.
+    auto evaluate(Position const& position) -> Inference {
+        auto result = Inference{};
+        auto lock = std::unique_lock(mutex);
+        auto id = next_batch;
+        if (pending.empty()) {
+            oldest = std::chrono::steady_clock::now();
+        }
+        pending.push_back(position);
+        outputs.push_back(&result);
+        if (pending.size() == 1 || pending.size() >= batch) {
+            arrived.notify_one();
+        }
+        done.wait(lock, [&]() { return completed > id; });
+        return result;
+    }
+
+    [[nodiscard]] auto average_batch() const -> f64 {
+        auto lock = std::lock_guard(mutex);
+        return batches == 0 ? 0.0 : f64(requests) / f64(batches);
+    }
+
+private:
+    PolicyNetwork const&                  network;
+    u32                                   batch;
+    std::chrono::microseconds             timeout;
+    mutable std::mutex                    mutex;
+    std::condition_variable               arrived;
+    std::condition_variable               done;
+    std::vector<Position>                 pending    = {};
+    std::vector<Inference*>               outputs    = {};
+    std::chrono::steady_clock::time_point oldest     = {};
+    u64                                   next_batch = 0;
+    u64                                   completed  = 0;
+    u64                                   batches    = 0;
+    u64                                   requests   = 0;
+    bool                                  quit       = false;
+    std::thread                           worker;
+
+    void run() {
+        std::vector<Position> positions;
+        std::vector<Inference*> targets;
+        std::vector<Inference> results;
+        auto lock = std::unique_lock(mutex);
+        while (true) {
+            arrived.wait(lock, [&]() { return quit || !pending.empty(); });
+            if (quit) {
+                return;
+            }
+            arrived.wait_until(lock, oldest + timeout, [&]() { return quit || pending.size() >= batch; });
+
+            auto id = next_batch++;
+            std::swap(positions, pending);
+            std::swap(targets, outputs);
+            batches += 1;
+            requests += positions.size();
+            lock.unlock();
+
+            results.resize(positions.size());
+            network.evaluate_batch(positions, results);
+
+            lock.lock();
+            for (size_t i = 0; i < targets.size(); ++i) {
+                *targets[i] = results[i];
+            }
+            positions.clear();
+            targets.clear();
+            completed = id + 1;
+            done.notify_all();
+        }
+    }
+};
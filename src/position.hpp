@@ -0,0 +1,330 @@
+#pragma once
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+enum class Side : u8 {
+    White,
+    Black,
+};
+
+constexpr auto operator~(Side side) -> Side {
+    return side == Side::White ? Side::Black : Side::White;
+}
+
+enum class Outcome : u8 {
+    None,
+    WhiteWins,
+    BlackWins,
+    Draw,
+};
+
+struct Move {
+    u8 from;
+    u8 to;
+
+    friend constexpr auto operator<=>(Move const&, Move const&) noexcept = default;
+};
+
+struct MoveList {
+    std::array<Move, 512> moves = {};
+    u32                   size  = {};
+
+    void push(Move move) {
+        moves[size++] = move;
+    }
+
+    auto begin() -> Move* { return moves.data(); }
+    auto end() -> Move* { return moves.data() + size; }
+    auto begin() const -> Move const* { return moves.data(); }
+    auto end() const -> Move const* { return moves.data() + size; }
+
+    auto operator[](u32 i) -> Move& { return moves[i]; }
+    auto operator[](u32 i) const -> Move const& { return moves[i]; }
+};
+
+// Square index is x + y * 8, with y growing down the board as main.cpp draws it.
+struct Bitboard {
+    static constexpr u64 file_a    = 0x0101010101010101ULL;
+    static constexpr u64 file_h    = 0x8080808080808080ULL;
+    static constexpr u64 camp_low  = 0x0000000000070707ULL;
+    static constexpr u64 camp_high = 0xE0E0E00000000000ULL;
+
+    static constexpr auto bit(i32 square) -> u64 {
+        return u64(1) << square;
+    }
+
+    static constexpr auto east(u64 b) -> u64 { return (b << 1) & ~file_a; }
+    static constexpr auto west(u64 b) -> u64 { return (b >> 1) & ~file_h; }
+    static constexpr auto south(u64 b) -> u64 { return b << 8; }
+    static constexpr auto north(u64 b) -> u64 { return b >> 8; }
+
+    static constexpr auto neighbours(u64 b) -> u64 {
+        return east(b) | west(b) | south(b) | north(b);
+    }
+
+    static constexpr auto home(Side side) -> u64 {
+        return side == Side::White ? camp_high : camp_low;
+    }
+
+    static constexpr auto target(Side side) -> u64 {
+        return side == Side::White ? camp_low : camp_high;
+    }
+
+    static auto compress(u64 bits, u64 mask) -> u64 {
+#if defined(__BMI2__)
+        return _pext_u64(bits, mask);
+#else
+        u64 result = 0;
+        for (u64 out = 1; mask != 0; mask &= mask - 1, out <<= 1) {
+            if ((bits & mask & -mask) != 0) {
+                result |= out;
+            }
+        }
+        return result;
+#endif
+    }
+
+    static auto expand(u64 bits, u64 mask) -> u64 {
+#if defined(__BMI2__)
+        return _pdep_u64(bits, mask);
+#else
+        u64 result = 0;
+        for (u64 in = 1; mask != 0; mask &= mask - 1, in <<= 1) {
+            if ((bits & in) != 0) {
+                result |= mask & -mask;
+            }
+        }
+        return result;
+#endif
+    }
+};
+
+// The rules are invariant under transposition (x, y) -> (y, x): steps and
+// jumps are orthogonal and both camps lie on the main diagonal. Reflecting
+// across the anti-diagonal with a colour swap maps the start position onto
+// itself too, but it does not preserve game values because only Black gets
+// the equalizing move, so canonical keys use the transpose alone.
+struct Symmetry {
+    static constexpr auto transpose(u64 b) -> u64 {
+        auto t = (b ^ (b >> 7)) & 0x00AA00AA00AA00AAULL;
+        b ^= t ^ (t << 7);
+        t = (b ^ (b >> 14)) & 0x0000CCCC0000CCCCULL;
+        b ^= t ^ (t << 14);
+        t = (b ^ (b >> 28)) & 0x00000000F0F0F0F0ULL;
+        b ^= t ^ (t << 28);
+        return b;
+    }
+
+    static constexpr auto transpose(i32 square) -> i32 {
+        return (square >> 3) | ((square & 7) << 3);
+    }
+
+    static constexpr auto transpose(Move move) -> Move {
+        return Move(u8(transpose(i32(move.from))), u8(transpose(i32(move.to))));
+    }
+};
+
+struct Zobrist {
+    std::array<std::array<u64, 64>, 2> pieces = {};
+    u64                                side   = {};
+
+    static constexpr auto new_() -> Zobrist {
+        auto state = u64(0x9E3779B97F4A7C15ULL);
+        auto next = [&state]() -> u64 {
+            auto z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        };
+
+        Zobrist zobrist = {};
+        for (auto& table : zobrist.pieces) {
+            for (auto& key : table) {
+                key = next();
+            }
+        }
+        zobrist.side = next();
+        return zobrist;
+    }
+};
+
+inline constexpr auto zobrist = Zobrist::new_();
+
+struct Rules {
+    // A side that still has pieces in its home camp after 40 moves each loses.
+    static constexpr u16 home_deadline = 80;
+    static constexpr u16 max_ply       = 400;
+};
+
+struct Position {
+    u64  white       = {};
+    u64  black       = {};
+    u64  hash        = {};
+    u64  mirror_hash = {};
+    u16  ply         = {};
+    Side side        = {};
+
+    static auto new_() -> Position {
+        return from_bitboards(Bitboard::camp_high, Bitboard::camp_low, Side::White, 0);
+    }
+
+    static auto from_bitboards(u64 white, u64 black, Side side, u16 ply) -> Position {
+        auto position = Position{
+            .white = white,
+            .black = black,
+            .hash = {},
+            .mirror_hash = {},
+            .ply = ply,
+            .side = side,
+        };
+        position.hash = position.compute_hash(false);
+        position.mirror_hash = position.compute_hash(true);
+        return position;
+    }
+
+    [[nodiscard]] auto pieces(Side who) const -> u64 {
+        return who == Side::White ? white : black;
+    }
+
+    [[nodiscard]] auto occupied() const -> u64 {
+        return white | black;
+    }
+
+    [[nodiscard]] auto compute_hash(bool mirrored) const -> u64 {
+        u64 h = side == Side::Black ? zobrist.side : 0;
+        auto w = mirrored ? Symmetry::transpose(white) : white;
+        auto b = mirrored ? Symmetry::transpose(black) : black;
+        for (auto bits = w; bits != 0; bits &= bits - 1) {
+            h ^= zobrist.pieces[0][std::countr_zero(bits)];
+        }
+        for (auto bits = b; bits != 0; bits &= bits - 1) {
+            h ^= zobrist.pieces[1][std::countr_zero(bits)];
+        }
+        return h;
+    }
+
+    // Same key for a position and its transpose. When `is_mirrored()` holds,
+    // moves stored under this key are in transposed coordinates.
+    [[nodiscard]] auto canonical_hash() const -> u64 {
+        return std::min(hash, mirror_hash);
+    }
+
+    [[nodiscard]] auto is_mirrored() const -> bool {
+        return mirror_hash < hash;
+    }
+
+    [[nodiscard]] auto destinations(i32 from) const -> u64 {
+        return reach(from, occupied(), ~u64(0));
+    }
+
+    // Single steps plus any chain of jumps over one adjacent piece of either color.
+    // The moving piece is lifted first, so its origin counts as empty during the chain.
+    // Squares outside `board` are off limits, which lets smaller boards share the code.
+    static auto reach(i32 from, u64 occupied, u64 board) -> u64 {
+        auto origin = Bitboard::bit(from);
+        occupied &= ~origin;
+        auto empty = board & ~occupied;
+
+        auto reached = Bitboard::neighbours(origin) & empty;
+        auto jumped = u64(0);
+        auto frontier = origin;
+        while (frontier != 0) {
+            auto next = (Bitboard::east(Bitboard::east(frontier) & occupied)
+                       | Bitboard::west(Bitboard::west(frontier) & occupied)
+                       | Bitboard::south(Bitboard::south(frontier) & occupied)
+                       | Bitboard::north(Bitboard::north(frontier) & occupied)) & empty;
+            frontier = next & ~jumped & ~origin;
+            jumped |= frontier;
+        }
+        return (reached | jumped) & ~origin;
+    }
+
+    void generate_moves(MoveList& list) const {
+        list.size = 0;
+        for (auto bits = pieces(side); bits != 0; bits &= bits - 1) {
+            auto from = std::countr_zero(bits);
+            for (auto dst = destinations(from); dst != 0; dst &= dst - 1) {
+                list.push(Move(u8(from), u8(std::countr_zero(dst))));
+            }
+        }
+    }
+
+    [[nodiscard]] auto is_legal(Move move) const -> bool {
+        if (move.from >= 64 || move.to >= 64) {
+            return false;
+        }
+        if ((pieces(side) & Bitboard::bit(move.from)) == 0) {
+            return false;
+        }
+        return (destinations(move.from) & Bitboard::bit(move.to)) != 0;
+    }
+
+    void make_move(Move move) {
+        toggle(move);
+        side = ~side;
+        ply += 1;
+    }
+
+    // Exact inverse of make_move(move): every update is an XOR, so undoing a
+    // move needs nothing but the move itself.
+    void unmake_move(Move move) {
+        side = ~side;
+        ply -= 1;
+        toggle(move);
+    }
+
+    // Flips the mover's piece between the two squares along with both hashes
+    // and the side key.
+    void toggle(Move move) {
+        auto mask = Bitboard::bit(move.from) | Bitboard::bit(move.to);
+        auto index = side == Side::White ? 0 : 1;
+        if (side == Side::White) {
+            white ^= mask;
+        } else {
+            black ^= mask;
+        }
+        hash ^= zobrist.pieces[index][move.from] ^ zobrist.pieces[index][move.to] ^ zobrist.side;
+        mirror_hash ^= zobrist.pieces[index][Symmetry::transpose(i32(move.from))]
+                     ^ zobrist.pieces[index][Symmetry::transpose(i32(move.to))]
+                     ^ zobrist.side;
+    }
+
+    // White moves first, so when White completes its camp Black is given one
+    // more move to equalize; the result is decided once a full round is over.
+    [[nodiscard]] auto outcome() const -> Outcome {
+        auto white_done = white == Bitboard::target(Side::White);
+        auto black_done = black == Bitboard::target(Side::Black);
+        if (side == Side::White) {
+            if (white_done && black_done) {
+                return Outcome::Draw;
+            }
+            if (white_done) {
+                return Outcome::WhiteWins;
+            }
+            if (black_done) {
+                return Outcome::BlackWins;
+            }
+            if (ply == Rules::home_deadline) {
+                auto white_home = (white & Bitboard::home(Side::White)) != 0;
+                auto black_home = (black & Bitboard::home(Side::Black)) != 0;
+                if (white_home && black_home) {
+                    return Outcome::Draw;
+                }
+                if (white_home) {
+                    return Outcome::BlackWins;
+                }
+                if (black_home) {
+                    return Outcome::WhiteWins;
+                }
+            }
+        } else if (black_done) {
+            return Outcome::BlackWins;
+        }
+        if (ply >= Rules::max_ply) {
+            return Outcome::Draw;
+        }
+        return Outcome::None;
+    }
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "position.hpp"
+
+// Once every White piece sits on a lower diagonal than every Black piece (with
+// at least one diagonal between them), neither side can jump over or block the
+// other again, and each side's remaining game is a solitaire race to its camp.
+struct Race {
+    static auto diagonals(u64 pieces) -> std::pair<i32, i32> {
+        auto low = 14;
+        auto high = 0;
+        for (auto bits = pieces; bits != 0; bits &= bits - 1) {
+            auto square = std::countr_zero(bits);
+            auto diagonal = (square & 7) + (square >> 3);
+            low = std::min(low, diagonal);
+            high = std::max(high, diagonal);
+        }
+        return {low, high};
+    }
+
+    static auto separated(Position const& position) -> bool {
+        if ((position.white & Bitboard::home(Side::White)) != 0 || (position.black & Bitboard::home(Side::Black)) != 0) {
+            return false;
+        }
+        if ((position.black & Bitboard::target(Side::White)) != 0 || (position.white & Bitboard::target(Side::Black)) != 0) {
+            return false;
+        }
+        auto [white_low, white_high] = diagonals(position.white);
+        auto [black_low, black_high] = diagonals(position.black);
+        return white_high + 1 < black_low;
+    }
+
+    // Result when the side to move needs `ours` more moves and the opponent `theirs`.
+    // White moves first, so Black may still equalize right after White finishes.
+    static auto outcome(Side side, i32 ours, i32 theirs) -> Outcome {
+        if (side == Side::White) {
+            if (ours < theirs) { return Outcome::WhiteWins; }
+            if (ours == theirs) { return Outcome::Draw; }
+            return Outcome::BlackWins;
+        }
+        if (ours <= theirs) { return Outcome::BlackWins; }
+        if (ours == theirs + 1) { return Outcome::Draw; }
+        return Outcome::WhiteWins;
+    }
+
+    // Plies from the side to move until the game is decided.
+    static auto length(Side side, i32 ours, i32 theirs) -> i32 {
+        if (side == Side::White) {
+            return 2 * std::min(ours, theirs);
+        }
+        return std::min(2 * ours - 1, 2 * theirs + 1);
+    }
+};
+
+struct RaceSolution {
+    i32          moves = {};
+    Option<Move> first = None;
+};
+
+// Exact number of moves one side needs to fill its target camp when nothing
+// else is on the board, found by IDA* with a transposition table of visited
+// configurations. Results are cached per configuration across calls.
+struct RaceSolver {
+    static constexpr u32 table_bits = 18;
+
+    explicit RaceSolver(u64 node_budget = 1 << 20) : budget(node_budget) {
+        for (auto side : {Side::White, Side::Black}) {
+            for (i32 square = 0; square < 64; ++square) {
+                auto x = square & 7;
+                auto y = square >> 3;
+                auto dx = side == Side::White ? std::max(0, x - 2) : std::max(0, 5 - x);
+                auto dy = side == Side::White ? std::max(0, y - 2) : std::max(0, 5 - y);
+                distance[u32(side)][square] = dx + dy;
+            }
+        }
+    }
+
+    // Both camps are symmetric under transposition, so only one of a
+    // configuration and its transpose is ever searched.
+    auto solve(u64 pieces, Side side) -> Option<RaceSolution> {
+        auto transposed = Symmetry::transpose(pieces);
+        if (transposed < pieces) {
+            return solve(transposed, side).map([](RaceSolution const& solution) {
+                return RaceSolution{
+                    .moves = solution.moves,
+                    .first = solution.first.map([](Move const& move) { return Symmetry::transpose(move); }),
+                };
+            });
+        }
+
+        auto key = pieces ^ (side == Side::Black ? 0x9E3779B97F4A7C15ULL : 0);
+        if (auto it = cache.find(key); it != cache.end()) {
+            return it->second;
+        }
+        if (visited.empty()) {
+            visited.resize(size_t(1) << table_bits);
+        }
+
+        this->side = side;
+        this->nodes = 0;
+        this->first = None;
+        auto bound = heuristic(pieces);
+        auto solution = Option<RaceSolution>(None);
+        while (true) {
+            stamp += 1;
+            auto next = search(pieces, 0, bound);
+            if (next == found) {
+                solution = Some(RaceSolution{.moves = bound, .first = first});
+                break;
+            }
+            if (next == infinite || nodes >= budget) {
+                break;
+            }
+            bound = next;
+        }
+        cache.emplace(key, solution);
+        return solution;
+    }
+
+private:
+    static constexpr i32 found    = -2;
+    static constexpr i32 infinite = std::numeric_limits<i32>::max();
+
+    struct Visit {
+        u64 key   = {};
+        u32 stamp = {};
+        i32 depth = {};
+    };
+
+    u64                                               budget   = {};
+    u64                                               nodes    = {};
+    u32                                               stamp    = {};
+    Side                                              side     = {};
+    Option<Move>                                      first    = None;
+    std::array<std::array<i32, 64>, 2>                distance = {};
+    std::vector<Visit>                                visited  = {};
+    std::unordered_map<u64, Option<RaceSolution>>     cache    = {};
+
+    // Every piece outside the camp needs a move of its own, and a single move
+    // can shorten the summed distance by at most two per other piece jumped.
+    auto heuristic(u64 pieces) const -> i32 {
+        auto total = 0;
+        for (auto bits = pieces; bits != 0; bits &= bits - 1) {
+            total += distance[u32(side)][std::countr_zero(bits)];
+        }
+        auto reach = std::max(1, 2 * (std::popcount(pieces) - 1));
+        auto outside = std::popcount(pieces & ~Bitboard::target(side));
+        return std::max(outside, (total + reach - 1) / reach);
+    }
+
+    auto search(u64 pieces, i32 depth, i32 bound) -> i32 {
+        auto estimate = depth + heuristic(pieces);
+        if (estimate > bound) {
+            return estimate;
+        }
+        if (pieces == Bitboard::target(side)) {
+            return found;
+        }
+        if (++nodes >= budget) {
+            return infinite;
+        }
+
+        auto& visit = visited[(pieces * 0x9E3779B97F4A7C15ULL) >> (64 - table_bits)];
+        if (visit.key == pieces && visit.stamp == stamp && visit.depth <= depth) {
+            return infinite;
+        }
+        visit = Visit{.key = pieces, .stamp = stamp, .depth = depth};
+
+        auto position = Position{
+            .white = side == Side::White ? pieces : 0,
+            .black = side == Side::Black ? pieces : 0,
+            .hash = {},
+            .mirror_hash = {},
+            .ply = {},
+            .side = side,
+        };
+        MoveList list;
+        position.generate_moves(list);
+
+        std::array<i32, 512> gains;
+        for (u32 i = 0; i < list.size; ++i) {
+            gains[i] = distance[u32(side)][list[i].from] - distance[u32(side)][list[i].to];
+        }
+
+        auto next = infinite;
+        for (u32 i = 0; i < list.size; ++i) {
+            auto pick = i;
+            for (u32 j = i + 1; j < list.size; ++j) {
+                if (gains[j] > gains[pick]) {
+                    pick = j;
+                }
+            }
+            std::swap(gains[i], gains[pick]);
+            std::swap(list[i], list[pick]);
+
+            auto child = pieces ^ Bitboard::bit(list[i].from) ^ Bitboard::bit(list[i].to);
+            auto result = search(child, depth + 1, bound);
+            if (result == found) {
+                if (depth == 0) {
+                    first = Some(Move(list[i]));
+                }
+                return found;
+            }
+            if (nodes >= budget) {
+                return infinite;
+            }
+            next = std::min(next, result);
+        }
+        return next;
+    }
+};
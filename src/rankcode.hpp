@@ -0,0 +1,166 @@
+#pragma once
+
+#include "eval.hpp"
+#include "records.hpp"
+#include "tablebase.hpp"
+
+// Moves are stored as their rank in a deterministic ordering of the legal
+// moves: the mover's static evaluation of each child under the default
+// parameters, best first, ties in generation order. Engine games mostly
+// play one of the first few, so the ranks are small and skewed and code to
+// about two bits a move. Changing EvalParams::new_ or the move generator
+// changes the ranks, which needs a new RankCode::version.
+struct MoveRanking {
+    static void ordered(Position const& position, MoveList& list) {
+        static auto const params = EvalParams::new_();
+        position.generate_moves(list);
+        std::array<std::pair<i32, u32>, 512> keys;
+        for (u32 i = 0; i < list.size; ++i) {
+            auto child = position;
+            child.make_move(list[i]);
+            keys[i] = {-Evaluator::evaluate(params, child), i};
+        }
+        std::sort(keys.begin(), keys.begin() + list.size, [](auto const& a, auto const& b) {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+        auto moves = list.moves;
+        for (u32 i = 0; i < list.size; ++i) {
+            list[i] = moves[keys[i].second];
+        }
+    }
+};
+
+// A compressed archive holds blocks of up to `block_games` games. Each block
+// stores its game headers transposed (byte i of every header together, so
+// the repeated names and time controls turn into runs) and the move ranks
+// of all its games as one byte stream, both through the tablebase's
+// Huffman block coder. A rank of 255 or more is escaped as 255, high, low.
+struct RankCode {
+    static constexpr u32 magic       = 0x5A524743; // "CGRZ"
+    static constexpr u32 version     = 1;
+    static constexpr u32 block_games = 1024;
+    static constexpr u8  escape      = 255;
+
+    struct BlockHeader {
+        u32 games       = {};
+        u32 rank_bytes  = {};
+        u32 header_size = {};
+        u32 ranks_size  = {};
+    };
+
+    static auto encode_moves(Position position, std::span<Move const> moves, std::vector<u8>& out) -> bool {
+        MoveList list;
+        for (auto move : moves) {
+            MoveRanking::ordered(position, list);
+            auto found = std::find(list.begin(), list.end(), move);
+            if (found == list.end()) {
+                return false;
+            }
+            auto rank = u32(found - list.begin());
+            if (rank < escape) {
+                out.push_back(u8(rank));
+            } else {
+                out.insert(out.end(), {escape, u8(rank >> 8), u8(rank)});
+            }
+            position.make_move(move);
+        }
+        return true;
+    }
+
+    // Reads `count` moves from `ranks`, advancing it past them.
+    static auto decode_moves(Position position, u32 count, std::span<u8 const>& ranks, std::vector<Move>& out) -> bool {
+        MoveList list;
+        for (u32 i = 0; i < count; ++i) {
+            if (ranks.empty()) {
+                return false;
+            }
+            auto rank = u32(ranks[0]);
+            auto used = size_t(1);
+            if (rank == escape) {
+                if (ranks.size() < 3) {
+                    return false;
+                }
+                rank = u32(ranks[1]) << 8 | ranks[2];
+                used = 3;
+            }
+            ranks = ranks.subspan(used);
+            MoveRanking::ordered(position, list);
+            if (rank >= list.size) {
+                return false;
+            }
+            out.push_back(list[rank]);
+            position.make_move(list[rank]);
+        }
+        return true;
+    }
+
+    // One block of games as written to the file: BlockHeader, then the two
+    // coded sections. False if a game holds an illegal move.
+    static auto encode_block(std::span<GameView const> games, std::vector<u8>& out) -> bool {
+        auto headers = std::vector<u8>(games.size() * sizeof(GameHeader));
+        auto ranks = std::vector<u8>{};
+        for (size_t g = 0; g < games.size(); ++g) {
+            auto bytes = reinterpret_cast<u8 const*>(games[g].header);
+            for (size_t b = 0; b < sizeof(GameHeader); ++b) {
+                headers[b * games.size() + g] = bytes[b];
+            }
+            if (!encode_moves(games[g].start(), games[g].moves, ranks)) {
+                return false;
+            }
+        }
+        auto coded_headers = BlockCoder::encode(headers);
+        auto coded_ranks = ranks.empty() ? std::vector<u8>{} : BlockCoder::encode(ranks);
+        auto block = BlockHeader{
+            .games = u32(games.size()),
+            .rank_bytes = u32(ranks.size()),
+            .header_size = u32(coded_headers.size()),
+            .ranks_size = u32(coded_ranks.size()),
+        };
+        auto raw = reinterpret_cast<u8 const*>(&block);
+        out.insert(out.end(), raw, raw + sizeof(block));
+        out.insert(out.end(), coded_headers.begin(), coded_headers.end());
+        out.insert(out.end(), coded_ranks.begin(), coded_ranks.end());
+        return true;
+    }
+
+    // Decodes the block at the front of `data` and advances past it. Every
+    // game is handed to `visit(header, moves)`.
+    template<typename Visit>
+    static auto decode_block(std::span<u8 const>& data, Visit&& visit) -> bool {
+        auto block = BlockHeader{};
+        if (data.size() < sizeof(block)) {
+            return false;
+        }
+        std::memcpy(&block, data.data(), sizeof(block));
+        data = data.subspan(sizeof(block));
+        if (block.games == 0 || block.games > block_games || data.size() < size_t(block.header_size) + block.ranks_size) {
+            return false;
+        }
+
+        auto headers = std::vector<u8>(block.games * sizeof(GameHeader));
+        auto ranks = std::vector<u8>(block.rank_bytes);
+        if (!BlockCoder::decode(data.subspan(0, block.header_size), headers)) {
+            return false;
+        }
+        if (!ranks.empty() && !BlockCoder::decode(data.subspan(block.header_size, block.ranks_size), ranks)) {
+            return false;
+        }
+        data = data.subspan(size_t(block.header_size) + block.ranks_size);
+
+        auto remaining = std::span<u8 const>(ranks);
+        auto moves = std::vector<Move>{};
+        for (size_t g = 0; g < block.games; ++g) {
+            auto header = GameHeader{};
+            auto bytes = reinterpret_cast<u8*>(&header);
+            for (size_t b = 0; b < sizeof(GameHeader); ++b) {
+                bytes[b] = headers[b * block.games + g];
+            }
+            moves.clear();
+            if (!decode_moves(header.start.unpack(), header.moves, remaining, moves)) {
+                return false;
+            }
+            visit(header, std::span<Move const>(moves));
+        }
+        return remaining.empty();
+    }
+};
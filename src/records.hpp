@@ -0,0 +1,218 @@
+#pragma once
+
+#include "file.hpp"
+#include "mapped.hpp"
+#include "packed.hpp"
+
+#include <string>
+#include <string_view>
+
+// Binary game archive. The file starts with an 8-byte header and then holds
+// one record per game: a 64-byte GameHeader followed by its moves as (from,
+// to) byte pairs, padded to 8 bytes so the next header stays aligned and can
+// be read in place from a mapping. A sidecar "<file>.idx" lists the offset
+// of every record as u64; the writer appends to both.
+struct GameHeader {
+    static constexpr size_t name_size = 16;
+
+    PackedPosition              start        = {};
+    std::array<char, name_size> white        = {};
+    std::array<char, name_size> black        = {};
+    u32                         base_ms      = {};
+    u32                         increment_ms = {};
+    u16                         moves        = {};
+    Outcome                     outcome      = {};
+    u8                          reserved     = {};
+    u32                         unused       = {};
+
+    static auto new_(Position const& start, std::string_view white, std::string_view black, Outcome outcome) -> GameHeader {
+        auto header = GameHeader{};
+        header.start = PackedPosition::pack(start);
+        header.outcome = outcome;
+        std::copy_n(white.data(), std::min(white.size(), name_size), header.white.data());
+        std::copy_n(black.data(), std::min(black.size(), name_size), header.black.data());
+        return header;
+    }
+
+    // Names are NUL padded and not terminated when they fill the field.
+    [[nodiscard]] auto player(Side side) const -> std::string_view {
+        auto& name = side == Side::White ? white : black;
+        return {name.data(), size_t(std::find(name.begin(), name.end(), '\0') - name.begin())};
+    }
+
+    // Bytes the record takes in the file, header included.
+    [[nodiscard]] auto record_size() const -> size_t {
+        return sizeof(GameHeader) + (size_t(moves) * sizeof(Move) + 7) / 8 * 8;
+    }
+};
+
+static_assert(sizeof(GameHeader) == 64);
+static_assert(sizeof(Move) == 2);
+
+struct GameRecords {
+    static constexpr u32 magic   = 0x46524743; // "CGRF"
+    static constexpr u32 version = 1;
+
+    static auto index_path(char const* path) -> std::string {
+        return std::string(path) + ".idx";
+    }
+};
+
+struct GameView {
+    GameHeader const*     header = nullptr;
+    std::span<Move const> moves  = {};
+
+    [[nodiscard]] auto start() const -> Position {
+        return header->start.unpack();
+    }
+};
+
+struct GameRecordWriter {
+    // Appends to the archive at `path`, starting it if there is none. A file
+    // that is there but is not an archive of this version is left alone.
+    static auto open(char const* path) -> Option<GameRecordWriter> {
+        if (auto existing = File(std::fopen(path, "rb")); existing != nullptr) {
+            auto header = std::array<u32, 2>{};
+            auto words = std::fread(header.data(), sizeof(u32), header.size(), existing.get());
+            if (words != 0 && header != std::array<u32, 2>{GameRecords::magic, GameRecords::version}) {
+                return None;
+            }
+        }
+        return start(File(std::fopen(path, "ab")), File(std::fopen(GameRecords::index_path(path).c_str(), "ab")));
+    }
+
+    // Starts a new archive at `path`, replacing any that is there.
+    static auto create(char const* path) -> Option<GameRecordWriter> {
+        return start(File(std::fopen(path, "wb")), File(std::fopen(GameRecords::index_path(path).c_str(), "wb")));
+    }
+
+    auto write(GameHeader header, std::span<Move const> moves) -> bool {
+        static constexpr std::array<u8, 8> padding = {};
+        header.moves = u16(std::min<size_t>(moves.size(), std::numeric_limits<u16>::max()));
+        auto move_bytes = size_t(header.moves) * sizeof(Move);
+        auto padding_bytes = header.record_size() - sizeof(header) - move_bytes;
+        auto ok = std::fwrite(&header, sizeof(header), 1, data.get()) == 1
+            && std::fwrite(moves.data(), 1, move_bytes, data.get()) == move_bytes
+            && std::fwrite(padding.data(), 1, padding_bytes, data.get()) == padding_bytes
+            && std::fwrite(&offset, sizeof(offset), 1, index.get()) == 1;
+        offset += header.record_size();
+        return ok;
+    }
+
+    // Records go out before their index entries. The reader checks the index
+    // against the data anyway, so a crash between the two costs a rescan.
+    auto flush() -> bool {
+        return std::fflush(data.get()) == 0 && std::fflush(index.get()) == 0;
+    }
+
+private:
+    File data;
+    File index;
+    u64  offset;
+
+    GameRecordWriter(File data, File index, u64 offset) : data(std::move(data)), index(std::move(index)), offset(offset) {}
+
+    static auto start(File data, File index) -> Option<GameRecordWriter> {
+        if (data == nullptr || index == nullptr) {
+            return None;
+        }
+        // "ab" only positions at the end on the first write, and an empty
+        // file, new or truncated, still needs its header.
+        std::fseek(data.get(), 0, SEEK_END);
+        auto offset = std::ftell(data.get());
+        if (offset < 0) {
+            return None;
+        }
+        if (offset == 0) {
+            std::array<u32, 2> header = {GameRecords::magic, GameRecords::version};
+            if (std::fwrite(header.data(), sizeof(header), 1, data.get()) != 1) {
+                return None;
+            }
+            offset = sizeof(header);
+        }
+        return Some(GameRecordWriter(std::move(data), std::move(index), u64(offset)));
+    }
+};
+
+// Read-only view of an archive. Games are handed out as pointers into the
+// mapping, so nothing is copied. The index is used as is when every entry
+// points at an aligned record that fits before the next one and the last
+// ends the file; otherwise (missing, stale, or short after a crash) the
+// records are walked once to rebuild it in memory, dropping a torn last one.
+struct GameArchive {
+    static auto open(char const* path) -> Option<GameArchive> {
+        auto data = MappedFile::open(path);
+        if (!data || data->size() < 8) {
+            return None;
+        }
+        auto* words = reinterpret_cast<u32 const*>(data->data());
+        if (words[0] != GameRecords::magic || words[1] != GameRecords::version) {
+            return None;
+        }
+        auto archive = GameArchive(std::move(data).unwrap(), MappedFile::open(GameRecords::index_path(path).c_str()));
+        if (!archive.use_index()) {
+            archive.scan();
+        }
+        return Some(std::move(archive));
+    }
+
+    [[nodiscard]] auto size() const -> size_t {
+        return offsets.size();
+    }
+
+    [[nodiscard]] auto operator[](size_t i) const -> GameView {
+        auto* record = data.data() + offsets[i];
+        auto* header = reinterpret_cast<GameHeader const*>(record);
+        return GameView{
+            .header = header,
+            .moves = {reinterpret_cast<Move const*>(record + sizeof(GameHeader)), header->moves},
+        };
+    }
+
+private:
+    MappedFile           data;
+    Option<MappedFile>   index;
+    std::vector<u64>     scanned = {};
+    std::span<u64 const> offsets = {};
+
+    GameArchive(MappedFile data, Option<MappedFile> index) : data(std::move(data)), index(std::move(index)) {}
+
+    [[nodiscard]] auto header_at(u64 offset) const -> GameHeader const& {
+        return *reinterpret_cast<GameHeader const*>(data.data() + offset);
+    }
+
+    auto use_index() -> bool {
+        if (!index || index->size() % sizeof(u64) != 0) {
+            return false;
+        }
+        auto entries = std::span(reinterpret_cast<u64 const*>(index->data()), index->size() / sizeof(u64));
+        auto end = u64(8);
+        for (auto offset : entries) {
+            if (offset % 8 != 0 || offset < end || offset > data.size() || data.size() - offset < sizeof(GameHeader)) {
+                return false;
+            }
+            end = offset + header_at(offset).record_size();
+            if (end > data.size()) {
+                return false;
+            }
+        }
+        if (end != data.size()) {
+            return false;
+        }
+        offsets = entries;
+        return true;
+    }
+
+    void scan() {
+        scanned.clear();
+        for (u64 offset = 8; offset + sizeof(GameHeader) <= data.size();) {
+            auto size = header_at(offset).record_size();
+            if (offset + size > data.size()) {
+                break;
+            }
+            scanned.push_back(offset);
+            offset += size;
+        }
+        offsets = scanned;
+    }
+};
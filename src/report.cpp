@@ -0,0 +1,285 @@
+#include "records.hpp"
+#include "notation.hpp"
+
+#include <charconv>
+#include <numeric>
+#include <string_view>
+
+static auto parse_u64(std::string_view text) -> Option<u64> {
+    u64 value = {};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        return None;
+    }
+    return Some(u64(value));
+}
+
+struct ReportConfig {
+    std::string archive = {};
+    u32         threads = std::max(1U, std::thread::hardware_concurrency());
+    u32         plies   = 12;
+    u32         top     = 10;
+    size_t      chunk   = 8192;
+};
+
+static void print_usage() {
+    fmt::print(
+        "usage: corners_report ARCHIVE [options]\n"
+        "  --threads N     worker threads (all cores)\n"
+        "  --plies N       count positions reached within the first N plies (12)\n"
+        "  --top N         moves and positions to list (10)\n"
+        "  --chunk N       games per work item (8192)\n"
+    );
+}
+
+static auto parse_args(i32 argc, const char* argv[]) -> Option<ReportConfig> {
+    if (argc < 2 || argc % 2 != 0) {
+        return None;
+    }
+    auto config = ReportConfig{.archive = argv[1]};
+    for (i32 i = 2; i + 1 < argc; i += 2) {
+        auto arg = std::string_view(argv[i]);
+        auto value = parse_u64(argv[i + 1]);
+        if (!value) {
+            return None;
+        }
+        if (arg == "--threads") {
+            config.threads = std::max<u32>(1, u32(*value));
+        } else if (arg == "--plies") {
+            config.plies = u32(*value);
+        } else if (arg == "--top") {
+            config.top = u32(*value);
+        } else if (arg == "--chunk") {
+            config.chunk = std::max<size_t>(1, *value);
+        } else {
+            return None;
+        }
+    }
+    return Some(std::move(config));
+}
+
+// Results are counted as 0 = White won, 1 = draw, 2 = Black won; a game
+// without a result counts as a draw.
+static auto result_index(Outcome outcome) -> u8 {
+    return outcome == Outcome::WhiteWins ? 0 : outcome == Outcome::BlackWins ? 2 : 1;
+}
+
+using Counts = std::array<u64, 3>;
+
+// A move is coded as side << 12 | from << 6 | to.
+static constexpr size_t move_codes = 2 * 64 * 64;
+
+// Positions are told apart by board and side to move; the ply is ignored.
+struct PositionKey {
+    u64 occupied = {};
+    u32 colours  = {};
+    u8  side     = {};
+
+    static auto of(Position const& position) -> PositionKey {
+        auto packed = PackedPosition::pack(position);
+        return PositionKey{.occupied = packed.occupied, .colours = packed.colours, .side = packed.side};
+    }
+
+    [[nodiscard]] auto unpack() const -> Position {
+        return PackedPosition{.occupied = occupied, .colours = colours, .side = side}.unpack();
+    }
+
+    friend constexpr auto operator==(PositionKey const&, PositionKey const&) noexcept -> bool = default;
+};
+
+struct PositionKeyHash {
+    auto operator()(PositionKey const& key) const noexcept -> size_t {
+        auto hash = (key.occupied ^ u64(key.colours) << 31 ^ key.side) * 0x9E3779B97F4A7C15ULL;
+        return size_t(hash ^ hash >> 32);
+    }
+};
+
+using PositionCounts = std::unordered_map<PositionKey, Counts, PositionKeyHash>;
+
+// Everything one chunk of games contributes, one column per attribute. The
+// columns are filled straight from the mapped records in a single pass and
+// then reduced by tight loops that touch only the columns they need. Opening
+// positions repeat across games, so they are counted in the thread's table
+// as they are reached rather than kept one per game.
+struct ChunkColumns {
+    std::vector<u16> lengths   = {};
+    std::vector<u8>  results   = {};
+    std::vector<u16> moves     = {};
+    std::vector<u32> move_game = {};
+
+    void clear() {
+        lengths.clear();
+        results.clear();
+        moves.clear();
+        move_game.clear();
+    }
+};
+
+// Per-thread totals, merged once all chunks are done.
+struct Totals {
+    u64                 games     = {};
+    u64                 bytes     = {};
+    Counts              results   = {};
+    Counts              plies     = {};
+    std::vector<Counts> moves     = std::vector<Counts>(move_codes);
+    PositionCounts      positions = {};
+
+    void add(ChunkColumns const& columns) {
+        for (size_t i = 0; i < columns.lengths.size(); ++i) {
+            results[columns.results[i]] += 1;
+            plies[columns.results[i]] += columns.lengths[i];
+        }
+        for (size_t i = 0; i < columns.moves.size(); ++i) {
+            moves[columns.moves[i]][columns.results[columns.move_game[i]]] += 1;
+        }
+        games += columns.lengths.size();
+    }
+
+    void merge(Totals const& other) {
+        games += other.games;
+        bytes += other.bytes;
+        for (size_t r = 0; r < 3; ++r) {
+            results[r] += other.results[r];
+            plies[r] += other.plies[r];
+        }
+        for (size_t i = 0; i < move_codes; ++i) {
+            for (size_t r = 0; r < 3; ++r) {
+                moves[i][r] += other.moves[i][r];
+            }
+        }
+        for (auto const& [key, counts] : other.positions) {
+            auto& merged = positions[key];
+            for (size_t r = 0; r < 3; ++r) {
+                merged[r] += counts[r];
+            }
+        }
+    }
+};
+
+static void fill_columns(GameArchive const& archive, size_t begin, size_t end, u32 plies, ChunkColumns& columns, Totals& totals) {
+    columns.clear();
+    for (auto i = begin; i < end; ++i) {
+        auto game = archive[i];
+        auto result = result_index(game.header->outcome);
+        columns.lengths.push_back(u16(game.moves.size()));
+        columns.results.push_back(result);
+        totals.bytes += game.header->record_size();
+
+        auto side = u16(game.header->start.side & 1);
+        for (auto move : game.moves) {
+            columns.moves.push_back(u16(side << 12 | move.from << 6 | move.to));
+            columns.move_game.push_back(u32(i - begin));
+            side ^= 1;
+        }
+
+        auto position = game.start();
+        for (size_t ply = 0; ply <= std::min<size_t>(plies, game.moves.size()); ++ply) {
+            if (ply > 0) {
+                position.make_move(game.moves[ply - 1]);
+            }
+            totals.positions[PositionKey::of(position)][result] += 1;
+        }
+    }
+}
+
+static auto format_counts(Counts const& counts, bool white_to_move) -> std::string {
+    auto games = counts[0] + counts[1] + counts[2];
+    auto wins = white_to_move ? counts[0] : counts[2];
+    auto score = (f64(wins) + 0.5 * f64(counts[1])) / f64(std::max<u64>(games, 1));
+    return fmt::format("{:>9}  +{} ={} -{}  {:.1f}%", games, counts[0], counts[1], counts[2], score * 100.0);
+}
+
+static void print_report(ReportConfig const& config, Totals const& totals, f64 seconds) {
+    auto games = std::max<u64>(totals.games, 1);
+    fmt::print(
+        "{} games, {:.1f} MB in {:.2f}s ({:.0f} games/s, {:.0f} MB/s)\n",
+        totals.games, f64(totals.bytes) / 1e6, seconds,
+        f64(totals.games) / std::max(seconds, 1e-9), f64(totals.bytes) / 1e6 / std::max(seconds, 1e-9)
+    );
+
+    auto& r = totals.results;
+    auto white_score = (f64(r[0]) + 0.5 * f64(r[1])) / f64(games);
+    fmt::print("results      White +{} ={} -{}, White scores {:.1f}% ({:+.1f} for moving first)\n", r[0], r[1], r[2], white_score * 100.0, (white_score - 0.5) * 100.0);
+
+    auto average = [](u64 plies, u64 count) { return f64(plies) / f64(std::max<u64>(count, 1)); };
+    fmt::print(
+        "avg length   {:.1f} plies (White wins {:.1f}, draws {:.1f}, Black wins {:.1f})\n",
+        average(totals.plies[0] + totals.plies[1] + totals.plies[2], games),
+        average(totals.plies[0], r[0]), average(totals.plies[1], r[1]), average(totals.plies[2], r[2])
+    );
+
+    std::vector<u16> order(move_codes);
+    std::iota(order.begin(), order.end(), u16(0));
+    auto total = [](Counts const& counts) { return counts[0] + counts[1] + counts[2]; };
+    auto shown = std::min<size_t>(config.top, order.size());
+    std::partial_sort(order.begin(), order.begin() + i64(shown), order.end(), [&](u16 a, u16 b) {
+        return total(totals.moves[a]) > total(totals.moves[b]);
+    });
+    fmt::print("most played moves (score for the mover)\n");
+    for (size_t i = 0; i < shown && total(totals.moves[order[i]]) != 0; ++i) {
+        auto code = order[i];
+        auto move = Move(u8((code >> 6) & 63), u8(code & 63));
+        auto white = (code >> 12) == 0;
+        fmt::print("  {} {}  {}\n", white ? "White" : "Black", Notation::move(move), format_counts(totals.moves[code], white));
+    }
+
+    auto distinct = std::vector<std::pair<PositionKey, Counts>>(totals.positions.begin(), totals.positions.end());
+    shown = std::min<size_t>(config.top, distinct.size());
+    // Ties are broken by the board so the listing does not depend on the table's order.
+    std::partial_sort(distinct.begin(), distinct.begin() + i64(shown), distinct.end(), [&](auto const& a, auto const& b) {
+        if (total(a.second) != total(b.second)) {
+            return total(a.second) > total(b.second);
+        }
+        return std::tie(a.first.occupied, a.first.colours, a.first.side) < std::tie(b.first.occupied, b.first.colours, b.first.side);
+    });
+    fmt::print("most reached positions within {} plies, {} distinct (score for the side to move)\n", config.plies, distinct.size());
+    for (size_t i = 0; i < shown; ++i) {
+        auto const& [position, counts] = distinct[i];
+        auto fen = Notation::to_fen(position.unpack());
+        fmt::print("  {:<40} {}\n", fen.substr(0, fen.rfind(' ')), format_counts(counts, position.side == u8(Side::White)));
+    }
+}
+
+auto main(i32 argc, const char* argv[]) -> i32 {
+    auto parsed = parse_args(argc, argv);
+    if (!parsed) {
+        print_usage();
+        return 1;
+    }
+    auto config = std::move(parsed).unwrap();
+    auto archive = GameArchive::open(config.archive.c_str());
+    if (!archive) {
+        fmt::print(stderr, "failed to open '{}'\n", config.archive);
+        return 1;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    auto next_chunk = std::atomic_size_t{0};
+    auto chunks = (archive->size() + config.chunk - 1) / config.chunk;
+    std::vector<Totals> totals(config.threads);
+    std::vector<std::thread> threads;
+    for (u32 t = 0; t < config.threads; ++t) {
+        threads.emplace_back([&, t]() {
+            auto columns = ChunkColumns{};
+            while (true) {
+                auto chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+                if (chunk >= chunks) {
+                    break;
+                }
+                auto begin = chunk * config.chunk;
+                auto end = std::min(begin + config.chunk, archive->size());
+                fill_columns(*archive, begin, end, config.plies, columns, totals[t]);
+                totals[t].add(columns);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (u32 t = 1; t < config.threads; ++t) {
+        totals[0].merge(totals[t]);
+    }
+    auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+    print_report(config, totals[0], seconds);
+    return 0;
+}
@@ -0,0 +1,365 @@
+#pragma once
+
+#include "position.hpp"
+#include "eval.hpp"
+#include "nnue.hpp"
+#include "pns.hpp"
+#include "race.hpp"
+#include "stats.hpp"
+#include "timeman.hpp"
+#include "tt.hpp"
+#include "ubfm.hpp"
+
+#include <functional>
+
+// `time` is a fixed budget for this move; `clock` lets the time manager pick
+// one. When both are set the smaller cap wins.
+struct SearchLimits {
+    i32                       depth = 64;
+    u64                       nodes = std::numeric_limits<u64>::max();
+    std::chrono::milliseconds time  = std::chrono::milliseconds::max();
+    Option<Clock>             clock = None;
+};
+
+// Late-game positions are first handed to the proof-number solver; a proven
+// win is played immediately without running alpha-beta.
+struct SolverConfig {
+    ProofLimits limits   = {};
+    u16         from_ply = Rules::home_deadline;
+};
+
+struct SearchResult {
+    Option<Move> best  = None;
+    i32          score = {};
+    i32          depth = {};
+    u64          nodes = {};
+};
+
+struct Engine {
+    static constexpr i32 max_ply = 128;
+
+    EvalParams              params     = EvalParams::new_();
+    Network const*          network    = nullptr;
+    TranspositionTable      tt         = {};
+    Option<SolverConfig>    solver     = None;
+    Option<BestFirstConfig> best_first = None;
+
+    // Runs on the searching thread after every completed iteration.
+    std::function<void(Position const&, SearchResult const&)> on_iteration = {};
+
+    explicit Engine(size_t tt_megabytes) : tt(TranspositionTable::new_(tt_megabytes)) {}
+
+    // Stops the running search, and also one handed to another thread with a
+    // ticket taken before this call that has not got going yet.
+    void stop() {
+        stops.fetch_add(1);
+        stopped.store(true);
+    }
+
+    [[nodiscard]] auto ticket() const -> u64 {
+        return stops.load();
+    }
+
+    // Snapshot of the running or last finished search, safe to call from any thread.
+    auto stats() const -> SearchStats {
+        auto lock = std::lock_guard(published_mutex);
+        return published;
+    }
+
+    // Follows best moves stored in the table from `position`; stops at the
+    // first missing or illegal entry and never revisits a position.
+    auto principal_variation(Position position, std::span<Move> line) -> u32 {
+        u32 length = 0;
+        std::array<u64, 64> seen = {};
+        while (length < std::min<size_t>(line.size(), seen.size()) && position.outcome() == Outcome::None) {
+            auto* entry = tt.probe(position.canonical_hash());
+            if (entry == nullptr || std::find(seen.begin(), seen.begin() + length, position.hash) != seen.begin() + length) {
+                break;
+            }
+            auto move = position.is_mirrored() ? Symmetry::transpose(entry->move) : Move(entry->move);
+            MoveList list;
+            position.generate_moves(list);
+            if (std::find(list.begin(), list.end(), move) == list.end()) {
+                break;
+            }
+            seen[length] = position.hash;
+            line[length++] = move;
+            position.make_move(move);
+        }
+        return length;
+    }
+
+    auto search(Position const& root, SearchLimits const& limits) -> SearchResult {
+        return search(root, limits, ticket());
+    }
+
+    auto search(Position const& root, SearchLimits const& limits, u64 ticket) -> SearchResult {
+        this->limits = limits;
+        this->current = SearchStats{.searches = 1};
+        this->started = std::chrono::steady_clock::now();
+        this->stopped.store(false);
+        if (stops.load() != ticket) {
+            this->stopped.store(true);
+        }
+        if (network != nullptr) {
+            network->refresh(accumulators[0], root.white, root.black);
+        }
+
+        auto result = SearchResult{};
+        MoveList list;
+        root.generate_moves(list);
+        if (list.size == 0) {
+            publish();
+            return result;
+        }
+        result.best = Some(Move(list[0]));
+
+        auto time_manager = limits.clock.map([&](Clock const& clock) { return TimeManager::new_(clock, root.ply); });
+        if (time_manager) {
+            if (list.size == 1) {
+                publish();
+                return result;
+            }
+            this->limits.time = std::min(this->limits.time, time_manager->maximum);
+        }
+
+        if (Race::separated(root)) {
+            auto ours = race.solve(root.pieces(root.side), root.side);
+            auto theirs = race.solve(root.pieces(~root.side), ~root.side);
+            if (ours && theirs && ours->first) {
+                auto length = Race::length(root.side, ours->moves, theirs->moves);
+                auto outcome = root.ply + length >= Rules::max_ply
+                    ? Outcome::Draw
+                    : Race::outcome(root.side, ours->moves, theirs->moves);
+                result.best = ours->first;
+                result.score = Score::from_outcome(outcome, root.side, length);
+                current.finish();
+                publish();
+                return result;
+            }
+        }
+
+        if (solver && root.ply >= solver->from_ply && !stopped.load(std::memory_order_relaxed)) {
+            auto proof = pns.prove(root, solver->limits);
+            if (proof.value == Proof::Win) {
+                result.best = proof.move;
+                result.score = Score::win - i32(proof.length);
+                current.finish();
+                publish();
+                return result;
+            }
+        }
+
+        if (best_first) {
+            auto found = BestFirst{tt, [&](Position const& position) { return evaluate_from_scratch(position); }}.search(
+                root, *best_first, [&](u64 nodes) {
+                    current.nodes = nodes;
+                    check_limits();
+                    return stopped.load(std::memory_order_relaxed);
+                }
+            );
+            result.best = found.best ? found.best : result.best;
+            result.score = found.score;
+            result.depth = found.depth;
+            current.depth = std::min(found.depth, SearchStats::max_depth);
+            current.nodes = found.nodes;
+            publish();
+            result.nodes = current.nodes;
+            return result;
+        }
+
+        auto max_depth = std::min({limits.depth, max_ply - 1, SearchStats::max_depth});
+        for (i32 depth = 1; depth <= max_depth; ++depth) {
+            auto iteration_nodes = current.nodes;
+            auto iteration_started = std::chrono::steady_clock::now();
+
+            root_best = None;
+            auto board = root;
+            auto score = negamax(board, depth, -Score::infinity, Score::infinity, 0);
+            if (stopped.load(std::memory_order_relaxed)) {
+                break;
+            }
+            result.best = root_best;
+            result.score = score;
+            result.depth = depth;
+
+            current.depth = depth;
+            current.iterations[depth] = IterationStats{
+                .nodes = current.nodes - iteration_nodes,
+                .micros = elapsed_micros(iteration_started),
+            };
+            publish();
+            if (on_iteration) {
+                result.nodes = current.nodes;
+                on_iteration(root, result);
+            }
+            if (std::abs(score) >= Score::decided) {
+                break;
+            }
+            if (time_manager) {
+                auto elapsed_ms = f64(elapsed_micros(started)) / 1000.0;
+                auto last_ms = f64(current.iterations[depth].micros) / 1000.0;
+                auto previous_ms = f64(current.iterations[depth - 1].micros) / 1000.0;
+                if (!time_manager->next_iteration(result.best, elapsed_ms, last_ms, previous_ms)) {
+                    break;
+                }
+            }
+        }
+        current.finish();
+        publish();
+        result.nodes = current.nodes;
+        return result;
+    }
+
+private:
+    SearchLimits                                  limits       = {};
+    SearchStats                                   current      = {};
+    mutable std::mutex                            published_mutex;
+    SearchStats                                   published    = {};
+    std::chrono::steady_clock::time_point         started      = {};
+    std::atomic_bool                              stopped      = {};
+    std::atomic_uint64_t                          stops        = {};
+    Option<Move>                                  root_best    = None;
+    std::array<Accumulator, max_ply>              accumulators = {};
+    ProofNumberSearch                             pns          = {};
+    RaceSolver                                    race         = RaceSolver();
+
+    static auto elapsed_micros(std::chrono::steady_clock::time_point since) -> u64 {
+        auto elapsed = std::chrono::steady_clock::now() - since;
+        return u64(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+
+    void publish() {
+        current.micros = elapsed_micros(started);
+        auto lock = std::lock_guard(published_mutex);
+        published = current;
+    }
+
+    void check_limits() {
+        publish();
+        if (current.nodes >= limits.nodes) {
+            stopped.store(true, std::memory_order_relaxed);
+        }
+        if (limits.time != std::chrono::milliseconds::max()) {
+            if (std::chrono::steady_clock::now() - started >= limits.time) {
+                stopped.store(true, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    auto static_eval(Position const& position, i32 ply) -> i32 {
+        if (network != nullptr) {
+            return network->evaluate(accumulators[ply], u32(position.side));
+        }
+        return Evaluator::evaluate(params, position);
+    }
+
+    auto evaluate_from_scratch(Position const& position) -> i32 {
+        if (network != nullptr) {
+            network->refresh(accumulators[0], position.white, position.black);
+        }
+        return static_eval(position, 0);
+    }
+
+    auto order_key(Position const& position, Move move) const -> i32 {
+        auto from = Evaluator::oriented(position.side, move.from);
+        auto to = Evaluator::oriented(position.side, move.to);
+        return params.distance[to] - params.distance[from];
+    }
+
+    // Plays moves on `position` and takes them back again. The accumulator
+    // stack keeps one entry per ply, so taking a move back needs no network
+    // update; the child's entry is simply overwritten by the next sibling.
+    auto negamax(Position& position, i32 depth, i32 alpha, i32 beta, i32 ply) -> i32 {
+        if ((++current.nodes & 1023) == 0) {
+            check_limits();
+        }
+        if (stopped.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+
+        auto outcome = position.outcome();
+        if (outcome != Outcome::None) {
+            return Score::from_outcome(outcome, position.side, ply);
+        }
+        if (depth <= 0 || ply >= max_ply - 1) {
+            return static_eval(position, ply);
+        }
+
+        auto key = position.canonical_hash();
+        auto mirrored = position.is_mirrored();
+        auto tt_move = Option<Move>(None);
+        current.tt_probes += 1;
+        if (auto* entry = tt.probe(key)) {
+            current.tt_hits += 1;
+            tt_move = Some(mirrored ? Symmetry::transpose(entry->move) : Move(entry->move));
+            if (ply > 0 && entry->depth >= depth) {
+                auto score = Score::from_tt(entry->score, ply);
+                if (entry->bound == Bound::Exact) {
+                    return score;
+                }
+                if (entry->bound == Bound::Lower && score >= beta) {
+                    return score;
+                }
+                if (entry->bound == Bound::Upper && score <= alpha) {
+                    return score;
+                }
+            }
+        }
+
+        MoveList list;
+        position.generate_moves(list);
+        if (list.size == 0) {
+            return -Score::win + ply;
+        }
+
+        std::array<i32, 512> keys;
+        for (u32 i = 0; i < list.size; ++i) {
+            keys[i] = tt_move && *tt_move == list[i] ? Score::infinity : order_key(position, list[i]);
+        }
+
+        auto alpha_orig = alpha;
+        auto best_score = -Score::infinity;
+        auto best_move = list[0];
+        for (u32 i = 0; i < list.size; ++i) {
+            auto pick = i;
+            for (u32 j = i + 1; j < list.size; ++j) {
+                if (keys[j] > keys[pick]) {
+                    pick = j;
+                }
+            }
+            std::swap(keys[i], keys[pick]);
+            std::swap(list[i], list[pick]);
+
+            auto move = list[i];
+            if (network != nullptr) {
+                accumulators[ply + 1] = accumulators[ply];
+                network->move_piece(accumulators[ply + 1], u32(position.side), move.from, move.to);
+            }
+            position.make_move(move);
+            auto score = -negamax(position, depth - 1, -beta, -alpha, ply + 1);
+            position.unmake_move(move);
+            if (stopped.load(std::memory_order_relaxed)) {
+                return 0;
+            }
+            if (score > best_score) {
+                best_score = score;
+                best_move = move;
+                if (ply == 0) {
+                    root_best = Some(Move(move));
+                }
+            }
+            if (score > alpha) {
+                alpha = score;
+            }
+            if (alpha >= beta) {
+                current.record_cutoff(i);
+                break;
+            }
+        }
+
+        auto bound = best_score <= alpha_orig ? Bound::Upper : best_score >= beta ? Bound::Lower : Bound::Exact;
+        tt.store(key, Score::to_tt(best_score, ply), depth, bound, mirrored ? Symmetry::transpose(best_move) : best_move);
+        return best_score;
+    }
+};
@@ -0,0 +1,1090 @@
+#include "game.hpp"
+#include "net.hpp"
+#include "mailbox.hpp"
+
+#include <csignal>
+#include <charconv>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+static auto parse_u64(std::string_view text) -> Option<u64> {
+    u64 value = {};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        return None;
+    }
+    return Some(u64(value));
+}
+
+static void print_usage() {
+    fmt::print(
+        "usage: corners_server [options]\n"
+        "       corners_server load [options]\n"
+        "server options:\n"
+        "  --port N          port to listen on (7070)\n"
+        "  --threads N       shards, each with its own thread, socket and games (1)\n"
+        "  --connections N   connections held at once, split over the shards (16384)\n"
+        "  --games N         games in play at once, split over the shards (8192)\n"
+        "  --report SECONDS  print statistics this often, 0 for never (10)\n"
+        "load options, for a test against a running server:\n"
+        "  --host HOST       server address (127.0.0.1)\n"
+        "  --port N          server port (7070)\n"
+        "  --clients N       simulated players playing random moves (1000)\n"
+        "  --threads N       threads the players are spread over (1)\n"
+        "  --watchers N      how many of the clients are spectators (0)\n"
+        "  --seconds N       length of the test (10)\n"
+    );
+}
+
+static std::atomic_bool stop_requested = false;
+
+static auto loss(Side side) -> Outcome {
+    return side == Side::White ? Outcome::BlackWins : Outcome::WhiteWins;
+}
+
+// Thousands of sockets need more descriptors than the usual soft limit.
+static void raise_file_limit() {
+    auto limit = rlimit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// Level-triggered epoll set; every descriptor is registered with a token
+// that names its slot.
+struct Poller {
+    static auto new_() -> Option<Poller> {
+        auto fd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (fd < 0) {
+            return None;
+        }
+        return Some(Poller(fd));
+    }
+
+    Poller(Poller&& other) noexcept : fd(std::exchange(other.fd, -1)) {}
+
+    ~Poller() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    auto add(i32 socket, u64 token, u32 events) const -> bool {
+        return control(EPOLL_CTL_ADD, socket, token, events);
+    }
+
+    auto modify(i32 socket, u64 token, u32 events) const -> bool {
+        return control(EPOLL_CTL_MOD, socket, token, events);
+    }
+
+    void remove(i32 socket) const {
+        ::epoll_ctl(fd, EPOLL_CTL_DEL, socket, nullptr);
+    }
+
+    auto wait(std::span<epoll_event> events, i32 timeout_ms) const -> std::span<epoll_event> {
+        auto count = ::epoll_wait(fd, events.data(), i32(events.size()), timeout_ms);
+        return events.subspan(0, size_t(std::max(count, 0)));
+    }
+
+private:
+    i32 fd = -1;
+
+    explicit Poller(i32 fd) : fd(fd) {}
+
+    auto control(i32 op, i32 socket, u64 token, u32 events) const -> bool {
+        auto event = epoll_event{.events = events, .data = {.u64 = token}};
+        return ::epoll_ctl(fd, op, socket, &event) == 0;
+    }
+};
+
+// Wakes a shard blocked in epoll_wait when another shard posted to it. The
+// flag keeps a burst of posts down to one write until the shard has run.
+struct Wakeup {
+    static auto new_() -> Option<std::unique_ptr<Wakeup>> {
+        auto fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd < 0) {
+            return None;
+        }
+        auto wakeup = std::make_unique<Wakeup>();
+        wakeup->fd = fd;
+        return Some(std::move(wakeup));
+    }
+
+    ~Wakeup() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    void notify() {
+        if (!signalled.exchange(true)) {
+            auto one = u64(1);
+            [[maybe_unused]] auto written = ::write(fd, &one, sizeof(one));
+        }
+    }
+
+    // Called by the owning shard before it drains its queues.
+    void clear() {
+        signalled.store(false);
+        auto count = u64{};
+        [[maybe_unused]] auto got = ::read(fd, &count, sizeof(count));
+    }
+
+    [[nodiscard]] auto native_handle() const -> i32 {
+        return fd;
+    }
+
+private:
+    i32              fd        = -1;
+    std::atomic_bool signalled = false;
+};
+
+struct ServerConfig {
+    u16 port        = 7070;
+    u32 threads     = 1;
+    u32 connections = 16384;
+    u32 games       = 8192;
+    u32 report      = 10;
+};
+
+struct ServerStats {
+    u64 accepted = {};
+    u64 started  = {};
+    u64 finished = {};
+    u64 moves    = {};
+    u64 rejected = {};
+    u64 relayed  = {};
+
+    void add(ServerStats const& other) {
+        accepted += other.accepted;
+        started += other.started;
+        finished += other.finished;
+        moves += other.moves;
+        rejected += other.rejected;
+        relayed += other.relayed;
+    }
+};
+
+// What a shard publishes for the statistics line.
+struct ShardReport {
+    ServerStats stats       = {};
+    u64         connections = {};
+    u64         games       = {};
+};
+
+struct Connection {
+    Option<Socket> socket       = None;
+    MessageReader  reader       = {};
+    MessageWriter  writer       = {};
+    u32            generation   = {}; // tells a reused slot from the one a reply was meant for
+    u32            game         = {};
+    Side           side         = {};
+    u8             list_limit   = {};
+    u8             listed       = {};
+    u16            list_pending = {}; // shards yet to answer a List
+    u32            watching     = {}; // game id followed as a spectator, or none
+    bool           writing      = false; // registered for EPOLLOUT
+    bool           dirty        = false; // queued for the next flush
+    bool           closing      = false; // queued to be closed
+};
+
+// A connection on some shard, as other shards address it.
+struct Peer {
+    u32 shard      = {};
+    u32 connection = {};
+    u32 generation = {};
+
+    friend constexpr auto operator==(Peer const&, Peer const&) noexcept -> bool = default;
+};
+
+struct GameSlot {
+    static constexpr size_t max_spectators = 4;
+
+    Position                            position   = Position::new_();
+    std::array<u32, 2>                  players    = {};
+    std::array<Peer, max_spectators>    spectators = {};
+    u8                                  watchers   = 0;
+    bool                                playing    = false;
+};
+
+// Everything that crosses shards. `peer` is the client connection the
+// message is about; Listed answers carry up to `count` game ids.
+struct ShardMessage {
+    static constexpr size_t list_limit = 16;
+
+    enum class Kind : u8 {
+        Watch,   // to the game's shard: add `peer` as a spectator of message.game
+        Unwatch, // to the game's shard: drop `peer` from the spectators of message.game
+        Deliver, // to the peer's shard: send `message` to the peer
+        List,    // to every other shard: list up to `count` games for the peer
+        Listed,  // back to the peer's shard: `games[0, count)`
+    };
+
+    Kind                             kind    = {};
+    u8                               count   = {};
+    Peer                             peer    = {};
+    Message                          message = {};
+    std::array<u32, list_limit>      games   = {};
+};
+
+using ShardQueue = RingQueue<ShardMessage, 256>;
+
+// One shard per thread, each with its own listening socket on the shared
+// port (the kernel spreads new connections over them through SO_REUSEPORT),
+// its own epoll set and its own slabs of connections and games. Players are
+// paired within a shard, so a move never leaves the thread that owns the
+// game. Lobby listing and spectating reach other shards through one
+// single-producer, single-consumer ring per pair of shards; a shard that
+// cannot post because a ring is full keeps the messages in order and
+// retries after its next batch.
+//
+// Connections and games are recycled through free lists, so nothing is
+// allocated while serving. Replies are only queued while events are handled
+// and go out in one send per connection once the batch is done; closing is
+// deferred the same way, so a slot is never reused while events for it may
+// still be pending.
+struct Shard {
+    static constexpr u32 none        = ~u32(0);
+    static constexpr u32 wake_token  = none - 1;
+    static constexpr u32 max_shards  = 64;
+    static constexpr u32 slot_bits   = 24;
+
+    static auto new_(u32 index, ServerConfig const& config) -> Option<std::unique_ptr<Shard>> {
+        auto listener = Socket::listen(config.port, config.threads > 1);
+        auto poller = Poller::new_();
+        auto wakeup = Wakeup::new_();
+        if (!listener || !poller || !wakeup) {
+            return None;
+        }
+        if (!poller->add(listener->native_handle(), none, EPOLLIN) || !poller->add((*wakeup)->native_handle(), wake_token, EPOLLIN)) {
+            return None;
+        }
+        auto shard = std::unique_ptr<Shard>(new Shard(std::move(listener).unwrap(), std::move(poller).unwrap()));
+        shard->index = index;
+        shard->config = config;
+        shard->wakeup = std::move(wakeup).unwrap();
+        auto connections = std::max<u32>(config.connections / config.threads, 1);
+        auto games = std::clamp<u32>(config.games / config.threads, 1, (1U << slot_bits) - 1);
+        shard->connections.resize(connections);
+        shard->games.resize(games);
+        for (auto i = connections; i > 0; --i) {
+            shard->free_connections.push_back(i - 1);
+        }
+        for (auto i = games; i > 0; --i) {
+            shard->free_games.push_back(i - 1);
+        }
+        shard->dirty.reserve(connections);
+        shard->closing.reserve(connections);
+        for (u32 i = 0; i < config.threads; ++i) {
+            shard->inbox.push_back(std::make_unique<ShardQueue>());
+        }
+        shard->outbox.resize(config.threads);
+        return Some(std::move(shard));
+    }
+
+    void run(std::span<std::unique_ptr<Shard> const> all) {
+        shards = all;
+        std::array<epoll_event, 256> buffer;
+        auto last_report = std::chrono::steady_clock::time_point{};
+        while (!stop_requested.load(std::memory_order_relaxed)) {
+            for (auto& event : poller.wait(buffer, 1000)) {
+                if (event.data.u64 == none) {
+                    accept_all();
+                    continue;
+                }
+                if (event.data.u64 == wake_token) {
+                    wakeup->clear();
+                    continue;
+                }
+                auto id = u32(event.data.u64);
+                auto& connection = connections[id];
+                if (connection.closing || !connection.socket) {
+                    continue;
+                }
+                if ((event.events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0) {
+                    auto fd = connection.socket->native_handle();
+                    if (!connection.reader.read(fd, [&](Message const& message) { return handle(id, message); })) {
+                        schedule_close(id);
+                    }
+                }
+                if ((event.events & EPOLLOUT) != 0) {
+                    mark_dirty(id);
+                }
+            }
+            drain_inbox();
+            while (!dirty.empty() || !closing.empty()) {
+                flush_all();
+                close_all();
+            }
+            send_posts();
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_report >= std::chrono::milliseconds(500)) {
+                report.publish(ShardReport{
+                    .stats = stats,
+                    .connections = connections.size() - free_connections.size(),
+                    .games = games.size() - free_games.size(),
+                });
+                last_report = now;
+            }
+        }
+    }
+
+    void wake() {
+        wakeup->notify();
+    }
+
+    auto take_report() -> Option<ShardReport> {
+        return report.take();
+    }
+
+private:
+    u32                                      index            = {};
+    ServerConfig                             config           = {};
+    Socket                                   listener;
+    Poller                                   poller;
+    std::unique_ptr<Wakeup>                  wakeup           = {};
+    std::span<std::unique_ptr<Shard> const>  shards           = {};
+    std::vector<std::unique_ptr<ShardQueue>> inbox            = {}; // one per sending shard
+    std::vector<std::deque<ShardMessage>>    outbox           = {}; // posts a full ring refused, per target
+    u64                                      posted           = {}; // shards to wake after this batch
+    std::vector<Connection>                  connections      = {};
+    std::vector<u32>                         free_connections = {};
+    std::vector<GameSlot>                    games            = {};
+    std::vector<u32>                         free_games       = {};
+    std::vector<u32>                         dirty            = {};
+    std::vector<u32>                         closing          = {};
+    u32                                      waiting          = none;
+    ServerStats                              stats            = {};
+    Mailbox<ShardReport>                     report           = {};
+
+    Shard(Socket listener, Poller poller) : listener(std::move(listener)), poller(std::move(poller)) {}
+
+    // Game ids name the shard in the top bits, so a Watch can be routed.
+    [[nodiscard]] auto game_id(u32 slot) const -> u32 {
+        return index << slot_bits | slot;
+    }
+
+    void accept_all() {
+        while (auto socket = listener.accept()) {
+            if (free_connections.empty()) {
+                continue;
+            }
+            auto id = free_connections.back();
+            auto fd = socket->native_handle();
+            if (!poller.add(fd, id, EPOLLIN)) {
+                continue;
+            }
+            free_connections.pop_back();
+            auto generation = connections[id].generation + 1;
+            connections[id] = Connection{.socket = std::move(socket), .generation = generation, .game = none, .watching = none};
+            stats.accepted += 1;
+        }
+    }
+
+    // False drops the connection: clients never send server messages.
+    auto handle(u32 id, Message const& message) -> bool {
+        auto& connection = connections[id];
+        switch (message.type) {
+            case MessageType::Join: join(id); return true;
+            case MessageType::Move: play(id, Move(message.from, message.to)); return true;
+            case MessageType::Resign:
+                if (connection.game == none) {
+                    reject(id);
+                } else {
+                    finish(connection.game, loss(connection.side));
+                }
+                return true;
+            case MessageType::List: list(id, message.value); return true;
+            case MessageType::Watch: watch(id, message.game); return true;
+            default: return false;
+        }
+    }
+
+    // Players are paired in the order they ask; the one who waited plays White.
+    void join(u32 id) {
+        if (connections[id].game != none || waiting == id) {
+            reject(id);
+            return;
+        }
+        if (waiting == none) {
+            waiting = id;
+            return;
+        }
+        if (free_games.empty()) {
+            reject(id);
+            return;
+        }
+        auto game = free_games.back();
+        free_games.pop_back();
+        games[game] = GameSlot{.players = {waiting, id}, .playing = true};
+        for (auto side : {Side::White, Side::Black}) {
+            auto player = games[game].players[size_t(side)];
+            connections[player].game = game;
+            connections[player].side = side;
+            send(player, Message::start(game_id(game), side));
+        }
+        waiting = none;
+        stats.started += 1;
+    }
+
+    void play(u32 id, Move move) {
+        auto& connection = connections[id];
+        if (connection.game == none) {
+            reject(id);
+            return;
+        }
+        auto game = connection.game;
+        auto& slot = games[game];
+        if (slot.position.side != connection.side || !slot.position.is_legal(move)) {
+            reject(id);
+            return;
+        }
+        slot.position.make_move(move);
+        stats.moves += 1;
+        auto outcome = Game::outcome_of(slot.position);
+        broadcast(game, Message::moved(game_id(game), move, outcome));
+        if (outcome != Outcome::None) {
+            release(game);
+        }
+    }
+
+    void finish(u32 game, Outcome outcome) {
+        broadcast(game, Message::ended(game_id(game), outcome));
+        release(game);
+    }
+
+    void broadcast(u32 game, Message const& message) {
+        auto& slot = games[game];
+        for (auto player : slot.players) {
+            send(player, message);
+        }
+        for (u8 i = 0; i < slot.watchers; ++i) {
+            deliver(slot.spectators[i], message);
+        }
+    }
+
+    void release(u32 game) {
+        for (auto player : games[game].players) {
+            connections[player].game = none;
+        }
+        games[game].playing = false;
+        free_games.push_back(game);
+        stats.finished += 1;
+    }
+
+    // Local games answer at once; every other shard is asked and the list
+    // is closed with no_game once the last of them has answered.
+    void list(u32 id, u8 limit) {
+        auto& connection = connections[id];
+        if (connection.list_pending != 0) {
+            reject(id);
+            return;
+        }
+        connection.list_limit = u8(std::clamp<size_t>(limit, 1, ShardMessage::list_limit));
+        connection.listed = 0;
+        for (u32 game = 0; game < games.size() && connection.listed < connection.list_limit; ++game) {
+            if (games[game].playing) {
+                send(id, Message::listed(game_id(game)));
+                connection.listed += 1;
+            }
+        }
+        auto peer = Peer{.shard = index, .connection = id, .generation = connection.generation};
+        for (u32 shard = 0; shard < shards.size(); ++shard) {
+            if (shard != index) {
+                post(shard, ShardMessage{.kind = ShardMessage::Kind::List, .count = connection.list_limit, .peer = peer});
+                connection.list_pending += 1;
+            }
+        }
+        if (connection.list_pending == 0) {
+            send(id, Message::listed(no_game));
+        }
+    }
+
+    // A connection follows one game at a time; watching another gives up
+    // its place with the previous one first.
+    void watch(u32 id, u32 game) {
+        auto shard = game >> slot_bits;
+        if (shard >= shards.size()) {
+            reject(id);
+            return;
+        }
+        unwatch(id);
+        connections[id].watching = game;
+        auto peer = Peer{.shard = index, .connection = id, .generation = connections[id].generation};
+        if (shard == index) {
+            add_spectator(game, peer);
+        } else {
+            post(shard, ShardMessage{.kind = ShardMessage::Kind::Watch, .peer = peer, .message = Message::watch(game)});
+        }
+    }
+
+    void unwatch(u32 id) {
+        auto& connection = connections[id];
+        if (connection.watching == none) {
+            return;
+        }
+        auto game = std::exchange(connection.watching, none);
+        auto shard = game >> slot_bits;
+        auto peer = Peer{.shard = index, .connection = id, .generation = connection.generation};
+        if (shard == index) {
+            remove_spectator(game, peer);
+        } else {
+            post(shard, ShardMessage{.kind = ShardMessage::Kind::Unwatch, .peer = peer, .message = Message::watch(game)});
+        }
+    }
+
+    // Runs on the game's shard. The spectator gets the board as it stands
+    // and then every move until the game ends.
+    void add_spectator(u32 game, Peer const& peer) {
+        auto slot = game & ((1U << slot_bits) - 1);
+        if (slot >= games.size() || !games[slot].playing || games[slot].watchers == GameSlot::max_spectators) {
+            deliver(peer, Message::rejected());
+            return;
+        }
+        auto& target = games[slot];
+        auto end = target.spectators.begin() + target.watchers;
+        if (std::find(target.spectators.begin(), end, peer) != end) {
+            deliver(peer, Message::rejected());
+            return;
+        }
+        target.spectators[target.watchers++] = peer;
+        deliver(peer, Message::watching(game, target.position));
+        deliver(peer, Message::board(0, u32(target.position.white)));
+        deliver(peer, Message::board(1, u32(target.position.white >> 32)));
+        deliver(peer, Message::board(2, u32(target.position.black)));
+        deliver(peer, Message::board(3, u32(target.position.black >> 32)));
+    }
+
+    // Runs on the game's shard. The game may have ended and its slot been
+    // reused since, so a peer that is not found is simply ignored.
+    void remove_spectator(u32 game, Peer const& peer) {
+        auto slot = game & ((1U << slot_bits) - 1);
+        if (slot >= games.size()) {
+            return;
+        }
+        auto& target = games[slot];
+        for (u8 i = 0; i < target.watchers; ++i) {
+            if (target.spectators[i] == peer) {
+                target.spectators[i] = target.spectators[--target.watchers];
+                return;
+            }
+        }
+    }
+
+    void deliver(Peer const& peer, Message const& message) {
+        if (peer.shard != index) {
+            post(peer.shard, ShardMessage{.kind = ShardMessage::Kind::Deliver, .peer = peer, .message = message});
+            return;
+        }
+        auto& connection = connections[peer.connection];
+        if (connection.generation == peer.generation && connection.socket) {
+            send(peer.connection, message);
+        }
+    }
+
+    void post(u32 shard, ShardMessage const& message) {
+        auto& pending = outbox[shard];
+        if (!pending.empty() || !shards[shard]->inbox[index]->push(message)) {
+            pending.push_back(message);
+        }
+        posted |= u64(1) << shard;
+        stats.relayed += 1;
+    }
+
+    void send_posts() {
+        for (u32 shard = 0; shard < outbox.size(); ++shard) {
+            auto& pending = outbox[shard];
+            while (!pending.empty() && shards[shard]->inbox[index]->push(pending.front())) {
+                pending.pop_front();
+            }
+            if (!pending.empty()) {
+                posted |= u64(1) << shard;
+            }
+        }
+        for (auto bits = posted; bits != 0; bits &= bits - 1) {
+            shards[std::countr_zero(bits)]->wake();
+        }
+        posted = 0;
+    }
+
+    void drain_inbox() {
+        for (auto& queue : inbox) {
+            while (auto message = queue->pop()) {
+                receive(*message);
+            }
+        }
+    }
+
+    void receive(ShardMessage const& message) {
+        switch (message.kind) {
+            case ShardMessage::Kind::Watch:
+                add_spectator(message.message.game, message.peer);
+                break;
+            case ShardMessage::Kind::Unwatch:
+                remove_spectator(message.message.game, message.peer);
+                break;
+            case ShardMessage::Kind::Deliver:
+                deliver(message.peer, message.message);
+                break;
+            case ShardMessage::Kind::List: {
+                auto reply = ShardMessage{.kind = ShardMessage::Kind::Listed, .peer = message.peer};
+                for (u32 game = 0; game < games.size() && reply.count < message.count; ++game) {
+                    if (games[game].playing) {
+                        reply.games[reply.count++] = game_id(game);
+                    }
+                }
+                post(message.peer.shard, reply);
+                break;
+            }
+            case ShardMessage::Kind::Listed: {
+                auto id = message.peer.connection;
+                auto& connection = connections[id];
+                if (connection.generation != message.peer.generation || !connection.socket || connection.list_pending == 0) {
+                    break;
+                }
+                for (u8 i = 0; i < message.count && connection.listed < connection.list_limit; ++i) {
+                    send(id, Message::listed(message.games[i]));
+                    connection.listed += 1;
+                }
+                connection.list_pending -= 1;
+                if (connection.list_pending == 0) {
+                    send(id, Message::listed(no_game));
+                }
+                break;
+            }
+        }
+    }
+
+    void reject(u32 id) {
+        stats.rejected += 1;
+        send(id, Message::rejected());
+    }
+
+    void send(u32 id, Message const& message) {
+        auto& connection = connections[id];
+        if (connection.closing) {
+            return;
+        }
+        if (!connection.writer.push(message)) {
+            schedule_close(id);
+            return;
+        }
+        mark_dirty(id);
+    }
+
+    void mark_dirty(u32 id) {
+        if (!connections[id].dirty) {
+            connections[id].dirty = true;
+            dirty.push_back(id);
+        }
+    }
+
+    void schedule_close(u32 id) {
+        if (!connections[id].closing) {
+            connections[id].closing = true;
+            closing.push_back(id);
+        }
+    }
+
+    void flush_all() {
+        for (auto id : dirty) {
+            auto& connection = connections[id];
+            connection.dirty = false;
+            if (connection.closing) {
+                continue;
+            }
+            auto fd = connection.socket->native_handle();
+            if (!connection.writer.flush(fd)) {
+                schedule_close(id);
+                continue;
+            }
+            auto writing = !connection.writer.empty();
+            if (writing != connection.writing) {
+                poller.modify(fd, id, EPOLLIN | (writing ? u32(EPOLLOUT) : 0));
+                connection.writing = writing;
+            }
+        }
+        dirty.clear();
+    }
+
+    // A player who disconnects loses the game they were in; a spectator
+    // gives up their place.
+    void close_all() {
+        for (size_t i = 0; i < closing.size(); ++i) {
+            auto id = closing[i];
+            auto& connection = connections[id];
+            if (waiting == id) {
+                waiting = none;
+            }
+            if (connection.game != none) {
+                finish(connection.game, loss(connection.side));
+            }
+            unwatch(id);
+            poller.remove(connection.socket->native_handle());
+            connection = Connection{.generation = connection.generation, .game = none, .watching = none};
+            free_connections.push_back(id);
+        }
+        closing.clear();
+    }
+};
+
+// Runs the shards on their own threads and prints their combined
+// statistics, which each shard publishes through a mailbox, from this one.
+static auto serve(ServerConfig const& config) -> i32 {
+    std::vector<std::unique_ptr<Shard>> shards;
+    for (u32 i = 0; i < config.threads; ++i) {
+        auto shard = Shard::new_(i, config);
+        if (!shard) {
+            fmt::print(stderr, "failed to listen on port {}\n", config.port);
+            return 1;
+        }
+        shards.push_back(std::move(shard).unwrap());
+    }
+    fmt::print("listening on port {} with {} shards\n", config.port, config.threads);
+
+    std::vector<std::thread> threads;
+    for (auto& shard : shards) {
+        threads.emplace_back([&shards, shard = shard.get()]() {
+            shard->run(shards);
+        });
+    }
+    std::vector<ShardReport> reports(shards.size());
+    auto last_report = std::chrono::steady_clock::now();
+    auto reported = ServerStats{};
+    while (!stop_requested.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto now = std::chrono::steady_clock::now();
+        auto seconds = std::chrono::duration<f64>(now - last_report).count();
+        if (config.report == 0 || seconds < f64(config.report)) {
+            continue;
+        }
+        auto total = ShardReport{};
+        for (size_t i = 0; i < shards.size(); ++i) {
+            if (auto report = shards[i]->take_report()) {
+                reports[i] = *report;
+            }
+            total.stats.add(reports[i].stats);
+            total.connections += reports[i].connections;
+            total.games += reports[i].games;
+        }
+        fmt::print(
+            "{} connections, {} games in play, {} started, {} finished, {:.0f} moves/s, {} relayed between shards, {} rejected\n",
+            total.connections, total.games, total.stats.started, total.stats.finished,
+            f64(total.stats.moves - reported.moves) / seconds, total.stats.relayed, total.stats.rejected
+        );
+        last_report = now;
+        reported = total.stats;
+    }
+    for (auto& shard : shards) {
+        shard->wake();
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return 0;
+}
+
+struct LoadConfig {
+    std::string host     = "127.0.0.1";
+    u16         port     = 7070;
+    u32         clients  = 1000;
+    u32         threads  = 1;
+    u32         watchers = 0;
+    u32         seconds  = 10;
+};
+
+struct LoadTotals {
+    u64 moves       = {};
+    u64 games       = {};
+    u64 rejected    = {};
+    u64 round_trips = {}; // microseconds from sending a move to its echo
+    u64 watched     = {}; // moves seen by spectators
+    u64 lists       = {};
+};
+
+struct LoadClient {
+    Option<Socket>                        socket  = None;
+    MessageReader                         reader  = {};
+    MessageWriter                         writer  = {};
+    Position                              position = Position::new_();
+    Option<Side>                          side    = None;
+    std::chrono::steady_clock::time_point sent    = {};
+    bool                                  writing = false;
+    bool                                  watcher = false;
+    std::array<u32, 16>                   listed  = {};
+    u8                                    found   = 0;
+
+    [[nodiscard]] auto to_move() const -> bool {
+        return side.map_or(false, [&](Side side) { return side == position.side; });
+    }
+};
+
+// One thread's share of the simulated players, all on one epoll set. Each
+// plays random legal moves and asks for a new game as soon as one ends.
+// Spectators list the games in play, follow a random one to its end and
+// start over, which keeps the traffic between shards busy.
+struct LoadRunner {
+    LoadConfig const&        config;
+    std::atomic_uint32_t&    ready;
+    std::atomic_bool const&  go;
+    std::atomic_bool const&  done;
+    LoadTotals               totals  = {};
+    std::vector<LoadClient>  clients = {};
+    std::mt19937_64          rng     = {};
+
+    auto run(u32 count, u32 watchers, u64 seed) -> bool {
+        rng.seed(seed);
+        auto poller = Poller::new_();
+        if (!poller) {
+            return false;
+        }
+        clients.resize(count);
+        for (u32 i = 0; i < count; ++i) {
+            clients[i].socket = Socket::connect(config.host.c_str(), config.port);
+            if (!clients[i].socket || !poller->add(clients[i].socket->native_handle(), i, EPOLLIN)) {
+                ready.fetch_add(1);
+                return false;
+            }
+        }
+        ready.fetch_add(1);
+        while (!go.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        for (u32 i = 0; i < count; ++i) {
+            clients[i].watcher = i < watchers;
+            clients[i].writer.push(clients[i].watcher ? Message::list(u8(clients[i].listed.size())) : Message::join());
+            flush(*poller, i);
+        }
+
+        std::array<epoll_event, 256> buffer;
+        while (!done.load(std::memory_order_relaxed)) {
+            for (auto& event : poller->wait(buffer, 100)) {
+                auto id = u32(event.data.u64);
+                auto& client = clients[id];
+                if ((event.events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0) {
+                    auto fd = client.socket->native_handle();
+                    if (!client.reader.read(fd, [&](Message const& message) { return handle(client, message); })) {
+                        return false;
+                    }
+                }
+                flush(*poller, id);
+            }
+        }
+        return true;
+    }
+
+private:
+    void flush(Poller const& poller, u32 id) {
+        auto& client = clients[id];
+        auto fd = client.socket->native_handle();
+        client.writer.flush(fd);
+        auto writing = !client.writer.empty();
+        if (writing != client.writing) {
+            poller.modify(fd, id, EPOLLIN | (writing ? u32(EPOLLOUT) : 0));
+            client.writing = writing;
+        }
+    }
+
+    auto handle(LoadClient& client, Message const& message) -> bool {
+        if (client.watcher) {
+            return spectate(client, message);
+        }
+        switch (message.type) {
+            case MessageType::Start:
+                client.position = Position::new_();
+                client.side = Some(Side(message.value));
+                play(client);
+                return true;
+            case MessageType::Moved:
+                if (client.to_move()) {
+                    totals.moves += 1;
+                    totals.round_trips += u64(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - client.sent).count());
+                }
+                client.position.make_move(Move(message.from, message.to));
+                if (Outcome(message.value) == Outcome::None) {
+                    play(client);
+                    return true;
+                }
+                end_game(client);
+                return true;
+            case MessageType::Ended:
+                end_game(client);
+                return true;
+            case MessageType::Rejected:
+                totals.rejected += 1;
+                if (!client.side) {
+                    client.writer.push(Message::join());
+                }
+                return true;
+            default: return false;
+        }
+    }
+
+    auto spectate(LoadClient& client, Message const& message) -> bool {
+        switch (message.type) {
+            case MessageType::Listed:
+                if (message.game != no_game) {
+                    client.listed[client.found] = message.game;
+                    client.found += size_t(client.found) + 1 < client.listed.size() ? 1 : 0;
+                    return true;
+                }
+                totals.lists += 1;
+                if (client.found != 0) {
+                    client.writer.push(Message::watch(client.listed[rng() % client.found]));
+                } else {
+                    client.writer.push(Message::list(u8(client.listed.size())));
+                }
+                client.found = 0;
+                return true;
+            case MessageType::Watching:
+            case MessageType::Board:
+                return true;
+            case MessageType::Moved:
+                totals.watched += 1;
+                if (Outcome(message.value) != Outcome::None) {
+                    client.writer.push(Message::list(u8(client.listed.size())));
+                }
+                return true;
+            case MessageType::Ended:
+            case MessageType::Rejected:
+                client.writer.push(Message::list(u8(client.listed.size())));
+                return true;
+            default: return false;
+        }
+    }
+
+    void play(LoadClient& client) {
+        if (!client.to_move()) {
+            return;
+        }
+        MoveList list;
+        client.position.generate_moves(list);
+        client.sent = std::chrono::steady_clock::now();
+        client.writer.push(Message::move(list[u32(rng() % list.size)]));
+    }
+
+    // Both players see the end; only White counts the game.
+    void end_game(LoadClient& client) {
+        totals.games += client.side.map_or(false, [](Side side) { return side == Side::White; }) ? 1 : 0;
+        client.side = None;
+        client.writer.push(Message::join());
+    }
+};
+
+static auto run_load(LoadConfig const& config) -> i32 {
+    auto ready = std::atomic_uint32_t{0};
+    auto go = std::atomic_bool{false};
+    auto done = std::atomic_bool{false};
+    auto failed = std::atomic_bool{false};
+    auto runners = std::vector<LoadRunner>{};
+    for (u32 t = 0; t < config.threads; ++t) {
+        runners.push_back(LoadRunner{.config = config, .ready = ready, .go = go, .done = done});
+    }
+    auto threads = std::vector<std::thread>{};
+    for (u32 t = 0; t < config.threads; ++t) {
+        auto count = config.clients / config.threads + (t < config.clients % config.threads ? 1 : 0);
+        auto watchers = config.watchers / config.threads + (t < config.watchers % config.threads ? 1 : 0);
+        threads.emplace_back([&, t, count, watchers]() {
+            if (!runners[t].run(count, watchers, t + 1)) {
+                failed.store(true);
+            }
+        });
+    }
+    while (ready.load() < config.threads) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto started = std::chrono::steady_clock::now();
+    go.store(true);
+    while (!failed.load() && std::chrono::steady_clock::now() - started < std::chrono::seconds(config.seconds)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    done.store(true);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (failed.load()) {
+        fmt::print(stderr, "lost the connection to {}:{}\n", config.host, config.port);
+        return 1;
+    }
+
+    auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+    auto totals = LoadTotals{};
+    for (auto& runner : runners) {
+        totals.moves += runner.totals.moves;
+        totals.games += runner.totals.games;
+        totals.rejected += runner.totals.rejected;
+        totals.round_trips += runner.totals.round_trips;
+        totals.watched += runner.totals.watched;
+        totals.lists += runner.totals.lists;
+    }
+    fmt::print(
+        "{} clients on {} threads for {:.1f}s: {:.0f} moves/s, {:.0f} games/s, {:.1f} us per move round trip, {} rejected\n",
+        config.clients, config.threads, seconds, f64(totals.moves) / seconds, f64(totals.games) / seconds,
+        f64(totals.round_trips) / f64(std::max<u64>(totals.moves, 1)), totals.rejected
+    );
+    if (config.watchers != 0) {
+        fmt::print("{} of them spectators: {:.0f} lists/s, {:.0f} moves/s watched\n", config.watchers, f64(totals.lists) / seconds, f64(totals.watched) / seconds);
+    }
+    return 0;
+}
+
+auto main(i32 argc, const char* argv[]) -> i32 {
+    auto load = argc >= 2 && std::string_view(argv[1]) == "load";
+    auto first = load ? 2 : 1;
+    if ((argc - first) % 2 != 0) {
+        print_usage();
+        return 1;
+    }
+    auto server_config = ServerConfig{};
+    auto load_config = LoadConfig{};
+    for (i32 i = first; i + 1 < argc; i += 2) {
+        auto arg = std::string_view(argv[i]);
+        if (load && arg == "--host") {
+            load_config.host = argv[i + 1];
+            continue;
+        }
+        auto value = parse_u64(argv[i + 1]);
+        if (!value) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--port" && *value <= 0xFFFF) {
+            server_config.port = u16(*value);
+            load_config.port = u16(*value);
+        } else if (!load && arg == "--connections" && *value != 0) {
+            server_config.connections = u32(*value);
+        } else if (!load && arg == "--games" && *value != 0) {
+            server_config.games = u32(*value);
+        } else if (!load && arg == "--report") {
+            server_config.report = u32(*value);
+        } else if (load && arg == "--clients" && *value != 0) {
+            load_config.clients = u32(*value);
+        } else if (arg == "--threads" && *value != 0) {
+            server_config.threads = std::min<u32>(u32(*value), Shard::max_shards);
+            load_config.threads = u32(*value);
+        } else if (load && arg == "--watchers") {
+            load_config.watchers = u32(*value);
+        } else if (load && arg == "--seconds") {
+            load_config.seconds = u32(*value);
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    raise_file_limit();
+    std::signal(SIGPIPE, SIG_IGN);
+    if (load) {
+        load_config.threads = std::min(load_config.threads, load_config.clients);
+        load_config.watchers = std::min(load_config.watchers, load_config.clients);
+        return run_load(load_config);
+    }
+
+    std::signal(SIGINT, [](i32) { stop_requested.store(true); });
+    std::signal(SIGTERM, [](i32) { stop_requested.store(true); });
+    return serve(server_config);
+}
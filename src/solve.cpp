@@ -0,0 +1,581 @@
+#include "position.hpp"
+#include "mapped.hpp"
+#include "tablebase.hpp"
+
+#include <charconv>
+#include <string_view>
+
+// The game on the top-left n x n corner of the bitboard with `pieces` per
+// side. Each camp is the `pieces` cells nearest its corner, so 3 and 6 pieces
+// give triangles and 4 a square. The home deadline is kept, at a ply chosen
+// per variant, but the ply limit is not: a game that never ends is a draw.
+struct Variant {
+    i32 size      = {};
+    i32 pieces    = {};
+    u32 deadline  = {};
+    u64 board     = {};
+    u64 camp_low  = {};
+    u64 camp_high = {};
+
+    static auto new_(i32 size, i32 pieces, u32 deadline) -> Option<Variant> {
+        if (size < 2 || size > 8 || pieces < 1 || 2 * pieces > size * size || deadline % 2 != 0) {
+            return None;
+        }
+
+        auto cells = std::vector<std::pair<i32, i32>>{};
+        auto variant = Variant{.size = size, .pieces = pieces, .deadline = deadline};
+        for (i32 y = 0; y < size; ++y) {
+            for (i32 x = 0; x < size; ++x) {
+                cells.emplace_back(x, y);
+                variant.board |= Bitboard::bit(x + y * 8);
+            }
+        }
+        std::sort(cells.begin(), cells.end(), [](auto const& a, auto const& b) {
+            auto ka = std::tuple(a.first + a.second, std::abs(a.first - a.second), a.second);
+            auto kb = std::tuple(b.first + b.second, std::abs(b.first - b.second), b.second);
+            return ka < kb;
+        });
+        for (i32 i = 0; i < pieces; ++i) {
+            auto [x, y] = cells[i];
+            variant.camp_low |= Bitboard::bit(x + y * 8);
+            variant.camp_high |= Bitboard::bit((size - 1 - x) + (size - 1 - y) * 8);
+        }
+        if ((variant.camp_low & variant.camp_high) != 0) {
+            return None;
+        }
+        return Some(Variant(variant));
+    }
+
+    [[nodiscard]] auto home(Side side) const -> u64 {
+        return side == Side::White ? camp_high : camp_low;
+    }
+
+    [[nodiscard]] auto target(Side side) const -> u64 {
+        return side == Side::White ? camp_low : camp_high;
+    }
+
+    // Position::outcome, with `at_deadline` standing in for the ply check.
+    [[nodiscard]] auto outcome(u64 white, u64 black, Side side, bool at_deadline) const -> Outcome {
+        auto white_done = white == target(Side::White);
+        auto black_done = black == target(Side::Black);
+        if (side == Side::White) {
+            if (white_done && black_done) {
+                return Outcome::Draw;
+            }
+            if (white_done) {
+                return Outcome::WhiteWins;
+            }
+            if (black_done) {
+                return Outcome::BlackWins;
+            }
+            if (at_deadline) {
+                auto white_home = (white & home(Side::White)) != 0;
+                auto black_home = (black & home(Side::Black)) != 0;
+                if (white_home && black_home) {
+                    return Outcome::Draw;
+                }
+                if (white_home) {
+                    return Outcome::BlackWins;
+                }
+                if (black_home) {
+                    return Outcome::WhiteWins;
+                }
+            }
+        } else if (black_done) {
+            return Outcome::BlackWins;
+        }
+        return Outcome::None;
+    }
+
+    void generate_moves(u64 white, u64 black, Side side, MoveList& list) const {
+        list.size = 0;
+        for (auto bits = side == Side::White ? white : black; bits != 0; bits &= bits - 1) {
+            auto from = std::countr_zero(bits);
+            for (auto dst = Position::reach(from, white | black, board); dst != 0; dst &= dst - 1) {
+                list.push(Move(u8(from), u8(std::countr_zero(dst))));
+            }
+        }
+    }
+};
+
+struct State {
+    u64  white = {};
+    u64  black = {};
+    Side side  = {};
+};
+
+// Combinatorial number system: the White set is ranked among the board cells
+// and the Black set among the cells White leaves free, so every placement of
+// the pieces gets a distinct index with no gaps. Before the deadline the ply
+// matters, so each ply up to it is a layer of its own with the side to move
+// implied; everything after it shares one tail layer holding both sides.
+struct StateIndex {
+    Variant                             variant    = {};
+    u32                                 cells      = {};
+    std::array<std::array<u64, 33>, 65> choose     = {};
+    u64                                 white_sets = {};
+    u64                                 black_sets = {};
+    u64                                 placements = {};
+    u32                                 tail       = {};
+    u64                                 total      = {};
+
+    static auto new_(Variant const& variant) -> StateIndex {
+        auto index = StateIndex{.variant = variant, .cells = u32(std::popcount(variant.board))};
+        for (u32 n = 0; n <= 64; ++n) {
+            index.choose[n][0] = 1;
+            for (u32 k = 1; k <= 32 && n > 0; ++k) {
+                index.choose[n][k] = index.choose[n - 1][k - 1] + index.choose[n - 1][k];
+            }
+        }
+        auto k = u32(variant.pieces);
+        index.white_sets = index.choose[index.cells][k];
+        index.black_sets = index.choose[index.cells - k][k];
+        index.placements = index.white_sets * index.black_sets;
+        index.tail = variant.deadline + 1;
+        index.total = index.begin(index.tail) + 2 * index.placements;
+        return index;
+    }
+
+    [[nodiscard]] auto begin(u32 layer) const -> u64 {
+        return u64(layer) * placements;
+    }
+
+    [[nodiscard]] auto end(u32 layer) const -> u64 {
+        return layer == tail ? total : begin(layer + 1);
+    }
+
+    [[nodiscard]] auto rank(State const& state, u32 layer) const -> u64 {
+        auto white = Bitboard::compress(state.white, variant.board);
+        auto black = Bitboard::compress(Bitboard::compress(state.black, variant.board), ~white);
+        auto rank = begin(layer) + rank_set(white) * black_sets + rank_set(black);
+        return layer == tail && state.side == Side::Black ? rank + placements : rank;
+    }
+
+    [[nodiscard]] auto unrank(u64 index) const -> std::pair<State, u32> {
+        auto layer = u32(std::min<u64>(index / placements, tail));
+        auto offset = index - begin(layer);
+        auto side = layer == tail ? (offset < placements ? Side::White : Side::Black) : (layer % 2 == 0 ? Side::White : Side::Black);
+        offset %= placements;
+        auto white = unrank_set(offset / black_sets, cells);
+        auto black = unrank_set(offset % black_sets, cells - u32(variant.pieces));
+        black = Bitboard::expand(black, ~white & (~u64(0) >> (64 - cells)));
+        auto state = State{
+            .white = Bitboard::expand(white, variant.board),
+            .black = Bitboard::expand(black, variant.board),
+            .side = side,
+        };
+        return {state, layer};
+    }
+
+private:
+    [[nodiscard]] auto rank_set(u64 bits) const -> u64 {
+        u64 rank = 0;
+        for (u32 i = 1; bits != 0; bits &= bits - 1, ++i) {
+            rank += choose[std::countr_zero(bits)][i];
+        }
+        return rank;
+    }
+
+    [[nodiscard]] auto unrank_set(u64 rank, u32 n) const -> u64 {
+        u64 bits = 0;
+        auto cell = n;
+        for (auto i = u32(variant.pieces); i > 0; --i) {
+            do {
+                cell -= 1;
+            } while (choose[cell][i] > rank);
+            rank -= choose[cell][i];
+            bits |= u64(1) << cell;
+        }
+        return bits;
+    }
+};
+
+// Fixed-width fields packed into a mapped file. Fields only ever gain bits,
+// set with atomic ORs, so worker threads can share words without locks and a
+// run cut off at any point leaves nothing inconsistent behind.
+template<u32 Bits>
+struct PackedArray {
+    static constexpr u64 per_word = 64 / Bits;
+
+    static auto create(char const* path, u64 count) -> Option<PackedArray> {
+        auto file = MappedFile::create(path, (count + per_word - 1) / per_word * sizeof(u64));
+        if (!file) {
+            return None;
+        }
+        return Some(PackedArray(std::move(file).unwrap()));
+    }
+
+    [[nodiscard]] auto get(u64 i) const -> u32 {
+        auto value = std::atomic_ref<u64>(word(i)).load(std::memory_order_relaxed);
+        return u32(value >> shift(i)) & ((1U << Bits) - 1);
+    }
+
+    void set(u64 i, u32 bits) const {
+        std::atomic_ref<u64>(word(i)).fetch_or(u64(bits) << shift(i), std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto sync() const -> bool {
+        return file.sync();
+    }
+
+private:
+    MappedFile file;
+
+    explicit PackedArray(MappedFile file) : file(std::move(file)) {}
+
+    [[nodiscard]] auto word(u64 i) const -> u64& {
+        return reinterpret_cast<u64*>(file.data())[i / per_word];
+    }
+
+    static auto shift(u64 i) -> u32 {
+        return u32(i % per_word) * Bits;
+    }
+};
+
+enum class Phase : u32 {
+    Reach,
+    Solve,
+    Done,
+};
+
+// Written after every segment of a pass, once the arrays are synced, so an
+// interrupted run picks up at the segment it was working on.
+struct Checkpoint {
+    static constexpr u32 magic = 0x564C5343; // "CSLV"
+
+    u32   header   = magic;
+    i32   size     = {};
+    i32   pieces   = {};
+    u32   deadline = {};
+    Phase phase    = Phase::Reach;
+    u32   layer    = {};
+    u32   pass     = {};
+    u64   cursor   = {};
+    u64   changes  = {};
+
+    static auto load(char const* path) -> Option<Checkpoint> {
+        auto file = File(std::fopen(path, "rb"));
+        if (file == nullptr) {
+            return None;
+        }
+        Checkpoint checkpoint;
+        if (std::fread(&checkpoint, sizeof(checkpoint), 1, file.get()) != 1 || checkpoint.header != magic) {
+            return None;
+        }
+        return Some(Checkpoint(checkpoint));
+    }
+
+    auto save(char const* path) const -> bool {
+        auto temporary = std::string(path) + ".tmp";
+        {
+            auto file = File(std::fopen(temporary.c_str(), "wb"));
+            if (file == nullptr || std::fwrite(this, sizeof(*this), 1, file.get()) != 1) {
+                return false;
+            }
+        }
+        return std::rename(temporary.c_str(), path) == 0;
+    }
+};
+
+// Side-to-move values. Whatever in the tail is still Unknown once a pass
+// changes nothing can be held forever by both sides, which is a draw.
+enum class Value : u32 {
+    Unknown,
+    Win,
+    Loss,
+    Draw,
+};
+
+struct SolveConfig {
+    i32         size     = 5;
+    i32         pieces   = 3;
+    Option<u32> deadline = None;
+    std::string dir      = ".";
+    u32         threads  = std::max(1U, std::thread::hardware_concurrency());
+};
+
+struct Solver {
+    static constexpr u64 segment = 1 << 24;
+    static constexpr u64 chunk   = 1 << 12;
+
+    Variant          variant;
+    StateIndex       index;
+    PackedArray<2>   reached;
+    PackedArray<2>   values;
+    u32              threads;
+
+    // Bit 0 of `reached` marks a reachable state, bit 1 one whose children are marked too.
+    auto reach(u64 i) const -> bool {
+        if (reached.get(i) != 1) {
+            return false;
+        }
+        auto [state, layer] = index.unrank(i);
+        if (variant.outcome(state.white, state.black, state.side, layer == variant.deadline) == Outcome::None) {
+            MoveList list;
+            variant.generate_moves(state.white, state.black, state.side, list);
+            for (auto move : list) {
+                reached.set(index.rank(apply(state, move), std::min(layer + 1, index.tail)), 1);
+            }
+        }
+        reached.set(i, 2);
+        return true;
+    }
+
+    // Layers before the tail only lead forward, so once the layer after them
+    // is final a single pass settles them and anything undecided is a draw.
+    auto solve(u64 i) const -> bool {
+        if ((reached.get(i) & 1) == 0 || Value(values.get(i)) != Value::Unknown) {
+            return false;
+        }
+        auto [state, layer] = index.unrank(i);
+        auto outcome = variant.outcome(state.white, state.black, state.side, layer == variant.deadline);
+        if (outcome != Outcome::None) {
+            auto won = outcome == (state.side == Side::White ? Outcome::WhiteWins : Outcome::BlackWins);
+            values.set(i, u32(outcome == Outcome::Draw ? Value::Draw : won ? Value::Win : Value::Loss));
+            return true;
+        }
+
+        // A side without moves loses, which the all-children-won rule covers.
+        MoveList list;
+        variant.generate_moves(state.white, state.black, state.side, list);
+        auto all_won = true;
+        for (auto move : list) {
+            auto value = Value(values.get(index.rank(apply(state, move), std::min(layer + 1, index.tail))));
+            if (value == Value::Loss) {
+                values.set(i, u32(Value::Win));
+                return true;
+            }
+            all_won = all_won && value == Value::Win;
+        }
+        if (all_won) {
+            values.set(i, u32(Value::Loss));
+            return true;
+        }
+        if (layer != index.tail) {
+            values.set(i, u32(Value::Draw));
+            return true;
+        }
+        return false;
+    }
+
+    // One pass over the checkpoint's layer from its cursor on. States are
+    // visited in place, so facts found early in a pass are used later in it.
+    template<typename Visit>
+    auto run_pass(Checkpoint& checkpoint, std::string const& path, Visit const& visit) const -> bool {
+        auto last = index.end(checkpoint.layer);
+        while (checkpoint.cursor < last) {
+            auto begin = checkpoint.cursor;
+            auto end = std::min(begin + segment, last);
+            auto next = std::atomic_uint64_t{begin};
+            auto changes = std::atomic_uint64_t{0};
+
+            auto worker = [&]() {
+                u64 local = 0;
+                while (true) {
+                    auto first = next.fetch_add(chunk, std::memory_order_relaxed);
+                    if (first >= end) {
+                        break;
+                    }
+                    for (auto i = first; i < std::min(first + chunk, end); ++i) {
+                        local += visit(i) ? 1 : 0;
+                    }
+                }
+                changes.fetch_add(local, std::memory_order_relaxed);
+            };
+            std::vector<std::thread> workers;
+            for (u32 t = 0; t < threads; ++t) {
+                workers.emplace_back(worker);
+            }
+            for (auto& thread : workers) {
+                thread.join();
+            }
+
+            checkpoint.cursor = end;
+            checkpoint.changes += changes.load();
+            if (!reached.sync() || !values.sync() || !checkpoint.save(path.c_str())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static auto apply(State const& state, Move move) -> State {
+        auto mask = Bitboard::bit(move.from) | Bitboard::bit(move.to);
+        return State{
+            .white = state.side == Side::White ? state.white ^ mask : state.white,
+            .black = state.side == Side::Black ? state.black ^ mask : state.black,
+            .side = ~state.side,
+        };
+    }
+};
+
+static auto parse_u64(std::string_view text) -> Option<u64> {
+    u64 value = {};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        return None;
+    }
+    return Some(u64(value));
+}
+
+static void print_usage() {
+    fmt::print(
+        "usage: corners_solve [options]\n"
+        "  --size N        board is N x N, at most 8 (5)\n"
+        "  --pieces N      pieces per side (3)\n"
+        "  --deadline N    ply by which both sides must have left home, even (8 per piece)\n"
+        "  --dir DIR       where the working arrays, checkpoint and result go (.)\n"
+        "  --threads N     worker threads (all cores)\n"
+        "Rerunning with the same options resumes an interrupted run.\n"
+    );
+}
+
+static auto parse_args(i32 argc, const char* argv[]) -> Option<SolveConfig> {
+    auto config = SolveConfig{};
+    if (argc % 2 == 0) {
+        return None;
+    }
+    for (i32 i = 1; i + 1 < argc; i += 2) {
+        auto arg = std::string_view(argv[i]);
+        if (arg == "--dir") {
+            config.dir = argv[i + 1];
+            continue;
+        }
+        auto value = parse_u64(argv[i + 1]);
+        if (!value) {
+            return None;
+        }
+        if (arg == "--size") {
+            config.size = i32(std::min<u64>(*value, 8));
+        } else if (arg == "--pieces") {
+            config.pieces = i32(std::min<u64>(*value, 32));
+        } else if (arg == "--deadline") {
+            config.deadline = Some(u32(std::min<u64>(*value, 1024)));
+        } else if (arg == "--threads") {
+            config.threads = std::max(1U, u32(*value));
+        } else {
+            return None;
+        }
+    }
+    return Some(std::move(config));
+}
+
+auto main(i32 argc, const char* argv[]) -> i32 {
+    auto parsed = parse_args(argc, argv);
+    if (!parsed) {
+        print_usage();
+        return 1;
+    }
+    auto config = std::move(parsed).unwrap();
+
+    auto deadline = config.deadline.unwrap_or(u32(8 * config.pieces));
+    auto variant = Variant::new_(config.size, config.pieces, deadline);
+    if (!variant) {
+        fmt::print(stderr, "no {}x{} variant with {} pieces per side and deadline {}\n", config.size, config.size, config.pieces, deadline);
+        return 1;
+    }
+    auto index = StateIndex::new_(*variant);
+    auto base = fmt::format("{}/{}x{}-{}-{}", config.dir, config.size, config.size, config.pieces, deadline);
+    auto checkpoint_path = base + ".ckpt";
+
+    // A resumed pass may have persisted results past its checkpoint without
+    // counting them, so it is never taken as the final one.
+    auto checkpoint = Checkpoint::load(checkpoint_path.c_str());
+    auto resumed = checkpoint && checkpoint->size == config.size && checkpoint->pieces == config.pieces && checkpoint->deadline == deadline;
+    if (!resumed) {
+        std::remove((base + ".reach").c_str());
+        std::remove((base + ".wdl").c_str());
+        checkpoint = Some(Checkpoint{.size = config.size, .pieces = config.pieces, .deadline = deadline});
+    } else {
+        checkpoint->changes += 1;
+        fmt::print("resuming layer {} pass {} at state {}\n", checkpoint->layer, checkpoint->pass, checkpoint->cursor);
+    }
+
+    auto reached = PackedArray<2>::create((base + ".reach").c_str(), index.total);
+    auto values = PackedArray<2>::create((base + ".wdl").c_str(), index.total);
+    if (!reached || !values) {
+        fmt::print(stderr, "failed to map working arrays under '{}'\n", config.dir);
+        return 1;
+    }
+    auto solver = Solver{
+        .variant = *variant,
+        .index = index,
+        .reached = std::move(reached).unwrap(),
+        .values = std::move(values).unwrap(),
+        .threads = config.threads,
+    };
+
+    auto start = State{.white = variant->home(Side::White), .black = variant->home(Side::Black), .side = Side::White};
+    solver.reached.set(index.rank(start, 0), 1);
+    fmt::print("{}x{} with {} pieces, deadline {}: {} states\n", config.size, config.size, config.pieces, deadline, index.total);
+
+    // Reach runs forward one pass per layer, then repeats over the tail until
+    // nothing new turns up. Solve repeats over the tail first, then settles
+    // the layers backwards from the deadline.
+    auto started = std::chrono::steady_clock::now();
+    while (checkpoint->phase != Phase::Done) {
+        auto reach = checkpoint->phase == Phase::Reach;
+        auto ok = reach
+            ? solver.run_pass(*checkpoint, checkpoint_path, [&](u64 i) { return solver.reach(i); })
+            : solver.run_pass(*checkpoint, checkpoint_path, [&](u64 i) { return solver.solve(i); });
+        if (!ok) {
+            fmt::print(stderr, "failed to checkpoint '{}'\n", checkpoint_path);
+            return 1;
+        }
+
+        auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+        auto layer = checkpoint->layer == index.tail ? fmt::format("tail pass {}", checkpoint->pass) : fmt::format("ply {}", checkpoint->layer);
+        fmt::print(
+            "{} {}: {} states {} ({:.1f}s)\n",
+            reach ? "reach" : "solve", layer, checkpoint->changes, reach ? "expanded" : "decided", seconds
+        );
+        std::fflush(stdout);
+
+        if (checkpoint->layer == index.tail && checkpoint->changes != 0) {
+            checkpoint->pass += 1;
+        } else if (reach) {
+            checkpoint->phase = checkpoint->layer == index.tail ? Phase::Solve : Phase::Reach;
+            checkpoint->layer = checkpoint->layer == index.tail ? index.tail : checkpoint->layer + 1;
+            checkpoint->pass = 0;
+        } else if (checkpoint->layer == 0) {
+            checkpoint->phase = Phase::Done;
+        } else {
+            checkpoint->layer = checkpoint->layer == index.tail ? variant->deadline : checkpoint->layer - 1;
+        }
+        checkpoint->cursor = index.begin(checkpoint->layer);
+        checkpoint->changes = 0;
+        if (!checkpoint->save(checkpoint_path.c_str())) {
+            fmt::print(stderr, "failed to checkpoint '{}'\n", checkpoint_path);
+            return 1;
+        }
+    }
+
+    // One byte per state in the result: 0 unreachable, otherwise a Value
+    // with draws by endless play folded into Draw.
+    auto table = std::vector<u8>(index.total);
+    auto counts = std::array<u64, 4>{};
+    for (u64 i = 0; i < index.total; ++i) {
+        if ((solver.reached.get(i) & 1) == 0) {
+            continue;
+        }
+        auto value = Value(solver.values.get(i));
+        value = value == Value::Unknown ? Value::Draw : value;
+        table[i] = u8(value);
+        counts[u32(value)] += 1;
+    }
+
+    auto names = std::array<char const*, 4>{"", "White wins", "Black wins", "draw"};
+    fmt::print(
+        "reachable {}: {} wins, {} losses, {} draws for the side to move\nstart position: {}\n",
+        counts[1] + counts[2] + counts[3], counts[1], counts[2], counts[3], names[table[index.rank(start, 0)]]
+    );
+
+    auto output = base + ".ctb";
+    if (!TablebaseWriter::write(output.c_str(), table)) {
+        fmt::print(stderr, "failed to write '{}'\n", output);
+        return 1;
+    }
+    fmt::print("wrote {}\n", output);
+    return 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+struct IterationStats {
+    u64 nodes  = {};
+    u64 micros = {};
+};
+
+// Plain counters owned by a single search thread. Readers take a copy and
+// merge copies from several threads, so the hot path never shares a cache line.
+struct SearchStats {
+    static constexpr i32 max_depth    = 64;
+    static constexpr u32 cutoff_slots = 8;
+
+    u64                                       searches          = {};
+    u64                                       nodes             = {};
+    u64                                       micros            = {};
+    u64                                       tt_probes         = {};
+    u64                                       tt_hits           = {};
+    u64                                       cutoffs           = {};
+    std::array<u64, cutoff_slots>             cutoff_index      = {};
+    i32                                       depth             = {};
+    f64                                       branching_sum     = {};
+    u64                                       branching_samples = {};
+    std::array<IterationStats, max_depth + 1> iterations        = {};
+
+    void record_cutoff(u32 index) {
+        cutoffs += 1;
+        cutoff_index[std::min(index, cutoff_slots - 1)] += 1;
+    }
+
+    // Ratio of the node counts of the two deepest completed iterations of this search.
+    void finish() {
+        if (depth >= 2 && iterations[depth - 1].nodes != 0) {
+            branching_sum += f64(iterations[depth].nodes) / f64(iterations[depth - 1].nodes);
+            branching_samples += 1;
+        }
+    }
+
+    void merge(SearchStats const& other) {
+        searches += other.searches;
+        nodes += other.nodes;
+        micros += other.micros;
+        tt_probes += other.tt_probes;
+        tt_hits += other.tt_hits;
+        cutoffs += other.cutoffs;
+        for (u32 i = 0; i < cutoff_slots; ++i) {
+            cutoff_index[i] += other.cutoff_index[i];
+        }
+        depth = std::max(depth, other.depth);
+        branching_sum += other.branching_sum;
+        branching_samples += other.branching_samples;
+        for (i32 i = 0; i <= max_depth; ++i) {
+            iterations[i].nodes += other.iterations[i].nodes;
+            iterations[i].micros += other.iterations[i].micros;
+        }
+    }
+
+    [[nodiscard]] auto nodes_per_second() const -> f64 {
+        return micros == 0 ? 0.0 : f64(nodes) * 1e6 / f64(micros);
+    }
+
+    [[nodiscard]] auto tt_hit_rate() const -> f64 {
+        return tt_probes == 0 ? 0.0 : f64(tt_hits) / f64(tt_probes);
+    }
+
+    [[nodiscard]] auto first_move_cutoff_rate() const -> f64 {
+        return cutoffs == 0 ? 0.0 : f64(cutoff_index[0]) / f64(cutoffs);
+    }
+
+    [[nodiscard]] auto branching_factor() const -> f64 {
+        return branching_samples == 0 ? 0.0 : branching_sum / f64(branching_samples);
+    }
+
+    [[nodiscard]] auto to_json() const -> std::string {
+        auto out = fmt::format(
+            "{{\"searches\":{},\"nodes\":{},\"micros\":{},\"nps\":{:.0f},\"depth\":{},"
+            "\"tt_probes\":{},\"tt_hits\":{},\"tt_hit_rate\":{:.4f},\"cutoffs\":{},"
+            "\"cutoff_index\":[{}],\"first_move_cutoff_rate\":{:.4f},\"branching_factor\":{:.3f},\"iterations\":[",
+            searches, nodes, micros, nodes_per_second(), depth,
+            tt_probes, tt_hits, tt_hit_rate(), cutoffs,
+            fmt::join(cutoff_index, ","), first_move_cutoff_rate(), branching_factor()
+        );
+        for (i32 d = 1; d <= depth; ++d) {
+            out += fmt::format(
+                "{}{{\"depth\":{},\"nodes\":{},\"micros\":{}}}",
+                d == 1 ? "" : ",", d, iterations[d].nodes, iterations[d].micros
+            );
+        }
+        out += "]}";
+        return out;
+    }
+};
@@ -0,0 +1,161 @@
+#include "tablebase.hpp"
+
+#include <charconv>
+#include <string_view>
+
+static auto parse_u64(std::string_view text) -> Option<u64> {
+    u64 value = {};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || ptr != text.data() + text.size()) {
+        return None;
+    }
+    return Some(u64(value));
+}
+
+static void print_usage() {
+    fmt::print(
+        "usage: corners_tablebase pack RAW OUT [--block N]\n"
+        "       corners_tablebase bench FILE [--raw RAW] [--probes N] [--cache N]\n"
+        "  RAW             uncompressed table, one byte per entry\n"
+        "  --block N       entries per compressed block (16384)\n"
+        "  --raw RAW       check every probe against the uncompressed table\n"
+        "  --probes N      random probes to time (1000000)\n"
+        "  --cache N       decoded blocks kept in memory (64)\n"
+    );
+}
+
+static auto read_all(char const* path) -> Option<std::vector<u8>> {
+    auto file = File(std::fopen(path, "rb"));
+    if (file == nullptr) {
+        return None;
+    }
+    std::vector<u8> bytes;
+    std::array<u8, 1 << 16> chunk;
+    while (auto count = std::fread(chunk.data(), 1, chunk.size(), file.get())) {
+        bytes.insert(bytes.end(), chunk.begin(), chunk.begin() + count);
+    }
+    return Some(std::move(bytes));
+}
+
+static auto pack(char const* input, char const* output, u32 block_size) -> i32 {
+    auto values = read_all(input);
+    if (!values) {
+        fmt::print(stderr, "failed to read '{}'\n", input);
+        return 1;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    if (!TablebaseWriter::write(output, *values, block_size)) {
+        fmt::print(stderr, "failed to write '{}'\n", output);
+        return 1;
+    }
+    auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+
+    auto table = Tablebase::open(output);
+    if (!table) {
+        fmt::print(stderr, "failed to reopen '{}'\n", output);
+        return 1;
+    }
+    fmt::print(
+        "{} entries, {} -> {} bytes ({:.2f}x) in {:.2f}s\n",
+        values->size(), values->size(), table->compressed_bytes(),
+        f64(values->size()) / f64(std::max<u64>(table->compressed_bytes(), 1)), seconds
+    );
+    return 0;
+}
+
+// Half of the probes land next to the previous one, the way a search walking
+// neighbouring positions tends to hit the same blocks; the rest are uniform.
+static auto bench(char const* path, Option<std::string> const& raw, u64 probes, u32 cache_blocks) -> i32 {
+    auto table = Tablebase::open(path, cache_blocks);
+    if (!table) {
+        fmt::print(stderr, "failed to open '{}'\n", path);
+        return 1;
+    }
+    if (table->entries() == 0) {
+        fmt::print(stderr, "'{}' is empty\n", path);
+        return 1;
+    }
+
+    auto expected = Option<std::vector<u8>>(None);
+    if (raw) {
+        expected = read_all((*raw).c_str());
+        if (!expected || expected->size() != table->entries()) {
+            fmt::print(stderr, "'{}' does not match the table size\n", *raw);
+            return 1;
+        }
+    }
+
+    auto rng = std::mt19937_64(1);
+    auto index = u64(0);
+    auto checksum = u64(0);
+    auto mismatches = u64(0);
+    auto started = std::chrono::steady_clock::now();
+    for (u64 i = 0; i < probes; ++i) {
+        auto r = rng();
+        index = (r & 1) != 0 ? (index + (r >> 48)) % table->entries() : (r >> 1) % table->entries();
+        auto value = table->probe(index);
+        if (!value) {
+            fmt::print(stderr, "corrupt block at entry {}\n", index);
+            return 1;
+        }
+        checksum += *value;
+        if (expected && (*expected)[index] != *value) {
+            mismatches += 1;
+        }
+    }
+    auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+
+    fmt::print(
+        "{} probes, {:.3f} us/probe, cache hit rate {:.3f}, {} bytes on disk for {} entries, checksum {}\n",
+        probes, seconds * 1e6 / f64(std::max<u64>(probes, 1)),
+        f64(table->hits()) / f64(std::max<u64>(table->hits() + table->misses(), 1)),
+        table->compressed_bytes(), table->entries(), checksum
+    );
+    if (mismatches != 0) {
+        fmt::print(stderr, "{} probes disagree with '{}'\n", mismatches, *raw);
+        return 1;
+    }
+    return 0;
+}
+
+auto main(i32 argc, const char* argv[]) -> i32 {
+    auto command = argc >= 3 ? std::string_view(argv[1]) : std::string_view();
+    auto positional = command == "pack" ? 2 : 1;
+    if ((command != "pack" && command != "bench") || argc < 2 + positional || (argc - 2 - positional) % 2 != 0) {
+        print_usage();
+        return 1;
+    }
+
+    auto block_size = TablebaseLayout::block_size;
+    auto probes = u64(1000000);
+    auto cache_blocks = u32(64);
+    auto raw = Option<std::string>(None);
+    for (i32 i = 2 + positional; i + 1 < argc; i += 2) {
+        auto arg = std::string_view(argv[i]);
+        if (arg == "--raw") {
+            raw = Some(std::string(argv[i + 1]));
+            continue;
+        }
+        auto value = parse_u64(argv[i + 1]);
+        if (!value) {
+            print_usage();
+            return 1;
+        }
+        if (arg == "--block") {
+            block_size = u32(std::clamp<u64>(*value, 1, 1 << 20));
+        } else if (arg == "--probes") {
+            probes = *value;
+        } else if (arg == "--cache") {
+            cache_blocks = u32(std::max<u64>(*value, 1));
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (command == "pack") {
+        return pack(argv[2], argv[3], block_size);
+    }
+    return bench(argv[2], raw, probes, cache_blocks);
+}
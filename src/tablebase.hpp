@@ -0,0 +1,544 @@
+#pragma once
+
+#include "file.hpp"
+
+// File layout: header, `blocks + 1` offsets into the data section, then the
+// blocks themselves. Every block holds `block_size` one-byte entries (the last
+// one may be shorter) and is compressed on its own, so a probe only ever
+// decodes one block.
+struct TablebaseLayout {
+    static constexpr u32 magic      = 0x4C425443; // "CTBL"
+    static constexpr u32 version    = 1;
+    static constexpr u32 block_size     = 1 << 14;
+    static constexpr u32 max_block_size = 1 << 24; // bounds the reader's cache
+};
+
+struct TablebaseHeader {
+    u32 magic      = TablebaseLayout::magic;
+    u32 version    = TablebaseLayout::version;
+    u64 entries    = {};
+    u32 block_size = {};
+    u32 blocks     = {};
+};
+
+static_assert(sizeof(TablebaseHeader) == 24);
+
+struct BitWriter {
+    std::vector<u8> bytes = {};
+    u64             buffer = {};
+    u32             count  = {};
+
+    void write(u32 value, u32 bits) {
+        buffer |= u64(value) << count;
+        count += bits;
+        while (count >= 8) {
+            bytes.push_back(u8(buffer));
+            buffer >>= 8;
+            count -= 8;
+        }
+    }
+
+    void flush() {
+        if (count != 0) {
+            bytes.push_back(u8(buffer));
+        }
+        buffer = 0;
+        count = 0;
+    }
+};
+
+struct BitReader {
+    std::span<u8 const> bytes    = {};
+    size_t              position = {};
+    u64                 buffer   = {};
+    u32                 count    = {};
+
+    auto peek(u32 bits) -> u32 {
+        while (count < bits) {
+            auto byte = position < bytes.size() ? bytes[position] : u8(0);
+            buffer |= u64(byte) << count;
+            position += 1;
+            count += 8;
+        }
+        return u32(buffer & ((u64(1) << bits) - 1));
+    }
+
+    void skip(u32 bits) {
+        buffer >>= bits;
+        count -= bits;
+    }
+
+    auto read(u32 bits) -> u32 {
+        auto value = peek(bits);
+        skip(bits);
+        return value;
+    }
+};
+
+// Run-length tokens under a canonical Huffman code. A literal symbol stores an
+// entry value; a run symbol `r` repeats the previous value `2^r + extra` more
+// times, with `r` extra bits following the code.
+struct BlockCoder {
+    static constexpr u32 run_symbols = 16;
+    static constexpr u32 symbols     = run_symbols + 256;
+    static constexpr u32 max_length  = 15;
+    static constexpr u32 fast_bits   = 10;
+
+    enum class Mode : u8 {
+        Raw,
+        Constant,
+        Huffman,
+    };
+
+    static auto encode(std::span<u8 const> values) -> std::vector<u8> {
+        if (std::all_of(values.begin(), values.end(), [&](u8 v) { return v == values[0]; })) {
+            return {u8(Mode::Constant), values[0]};
+        }
+
+        // Tokens are (symbol, extra bits) pairs collected before the code is known.
+        auto tokens = std::vector<std::pair<u16, u16>>{};
+        auto frequency = std::array<u32, symbols>{};
+        // A run repeats its value at most 2^run_symbols - 1 times, the most a
+        // repeat symbol plus its extra bits can say; longer runs are split.
+        for (size_t i = 0; i < values.size();) {
+            auto run = size_t(1);
+            while (i + run < values.size() && values[i + run] == values[i] && run < (size_t(1) << run_symbols)) {
+                run += 1;
+            }
+            tokens.emplace_back(u16(run_symbols + values[i]), 0);
+            frequency[run_symbols + values[i]] += 1;
+            if (run > 1) {
+                auto repeat = u32(run - 1);
+                auto r = u32(std::bit_width(repeat) - 1);
+                tokens.emplace_back(u16(r), u16(repeat - (1U << r)));
+                frequency[r] += 1;
+            }
+            i += run;
+        }
+
+        auto lengths = code_lengths(frequency);
+        auto codes = canonical_codes(lengths);
+        auto used = symbols;
+        while (lengths[used - 1] == 0) {
+            used -= 1;
+        }
+
+        BitWriter writer = {};
+        writer.write(u32(Mode::Huffman), 8);
+        writer.write(used, 16);
+        for (u32 s = 0; s < used; ++s) {
+            writer.write(lengths[s], 4);
+        }
+        for (auto [symbol, extra] : tokens) {
+            writer.write(codes[symbol], lengths[symbol]);
+            if (symbol < run_symbols) {
+                writer.write(extra, symbol);
+            }
+        }
+        writer.flush();
+
+        if (writer.bytes.size() >= values.size() + 1) {
+            auto raw = std::vector<u8>{u8(Mode::Raw)};
+            raw.insert(raw.end(), values.begin(), values.end());
+            return raw;
+        }
+        return std::move(writer.bytes);
+    }
+
+    static auto decode(std::span<u8 const> data, std::span<u8> values) -> bool {
+        if (data.empty()) {
+            return false;
+        }
+        switch (Mode(data[0])) {
+            case Mode::Raw:
+                if (data.size() != values.size() + 1) {
+                    return false;
+                }
+                std::copy(data.begin() + 1, data.end(), values.begin());
+                return true;
+            case Mode::Constant:
+                if (data.size() != 2) {
+                    return false;
+                }
+                std::fill(values.begin(), values.end(), data[1]);
+                return true;
+            case Mode::Huffman:
+                break;
+            default:
+                return false;
+        }
+
+        BitReader reader = {.bytes = data.subspan(1)};
+        auto used = reader.read(16);
+        if (used > symbols) {
+            return false;
+        }
+        auto count = std::array<u16, max_length + 1>{};
+        auto lengths = std::array<u8, symbols>{};
+        for (u32 s = 0; s < used; ++s) {
+            lengths[s] = u8(reader.read(4));
+            count[lengths[s]] += 1;
+        }
+
+        // Symbols sorted by code length, then by value, as in canonical order.
+        auto offsets = std::array<u16, max_length + 2>{};
+        for (u32 len = 1; len <= max_length; ++len) {
+            offsets[len + 1] = u16(offsets[len] + count[len]);
+        }
+        auto sorted = std::array<u16, symbols>{};
+        for (u32 s = 0; s < used; ++s) {
+            if (lengths[s] != 0) {
+                sorted[offsets[lengths[s]]++] = u16(s);
+            }
+        }
+
+        // Codes up to `fast_bits` long resolve with one lookup on the next bits.
+        auto fast = std::array<u16, 1 << fast_bits>{};
+        auto codes = canonical_codes(lengths);
+        for (u32 s = 0; s < used; ++s) {
+            if (lengths[s] != 0 && lengths[s] <= fast_bits) {
+                for (u32 high = 0; high < (1U << (fast_bits - lengths[s])); ++high) {
+                    fast[codes[s] | (high << lengths[s])] = u16((s << 4) | lengths[s]);
+                }
+            }
+        }
+
+        size_t i = 0;
+        while (i < values.size()) {
+            auto entry = fast[reader.peek(fast_bits)];
+            auto symbol = i32(entry >> 4);
+            if (entry != 0) {
+                reader.skip(entry & 15);
+            } else {
+                symbol = next_symbol(reader, count, sorted);
+            }
+            if (symbol < 0) {
+                return false;
+            }
+            if (symbol >= i32(run_symbols)) {
+                values[i++] = u8(symbol - i32(run_symbols));
+                continue;
+            }
+            auto repeat = (1U << symbol) + reader.read(u32(symbol));
+            if (i == 0 || i + repeat > values.size()) {
+                return false;
+            }
+            std::fill_n(values.begin() + i, repeat, values[i - 1]);
+            i += repeat;
+        }
+        // Lookahead may run past the end; only consumed bits must fit.
+        return reader.position * 8 - reader.count <= reader.bytes.size() * 8;
+    }
+
+private:
+    // Walks the canonical code one bit at a time; codes of each length are
+    // consecutive integers starting right after the previous length's range.
+    static auto next_symbol(BitReader& reader, std::array<u16, max_length + 1> const& count, std::array<u16, symbols> const& sorted) -> i32 {
+        i32 code = 0;
+        i32 first = 0;
+        i32 index = 0;
+        for (u32 len = 1; len <= max_length; ++len) {
+            code |= i32(reader.read(1));
+            if (code - first < i32(count[len])) {
+                return sorted[index + code - first];
+            }
+            index += count[len];
+            first = (first + count[len]) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    // Plain Huffman construction; frequencies are flattened until the
+    // deepest code fits in `max_length` bits.
+    static auto code_lengths(std::array<u32, symbols> frequency) -> std::array<u8, symbols> {
+        while (true) {
+            struct Node {
+                u64 weight = {};
+                i32 parent = -1;
+            };
+
+            auto nodes = std::vector<Node>{};
+            auto queue = std::vector<std::pair<u64, i32>>{};
+            auto leaf = std::array<i32, symbols>{};
+            leaf.fill(-1);
+            for (u32 s = 0; s < symbols; ++s) {
+                if (frequency[s] != 0) {
+                    leaf[s] = i32(nodes.size());
+                    queue.emplace_back(frequency[s], i32(nodes.size()));
+                    nodes.push_back(Node{.weight = frequency[s]});
+                }
+            }
+
+            auto lengths = std::array<u8, symbols>{};
+            if (queue.size() == 1) {
+                auto only = std::find(leaf.begin(), leaf.end(), queue[0].second);
+                lengths[size_t(only - leaf.begin())] = 1;
+                return lengths;
+            }
+
+            auto greater = [](auto const& a, auto const& b) { return a.first > b.first; };
+            std::make_heap(queue.begin(), queue.end(), greater);
+            while (queue.size() > 1) {
+                std::pop_heap(queue.begin(), queue.end(), greater);
+                auto a = queue.back();
+                queue.pop_back();
+                std::pop_heap(queue.begin(), queue.end(), greater);
+                auto b = queue.back();
+                queue.pop_back();
+
+                auto parent = i32(nodes.size());
+                nodes.push_back(Node{.weight = a.first + b.first});
+                nodes[a.second].parent = parent;
+                nodes[b.second].parent = parent;
+                queue.emplace_back(a.first + b.first, parent);
+                std::push_heap(queue.begin(), queue.end(), greater);
+            }
+
+            auto deepest = u32(0);
+            for (u32 s = 0; s < symbols; ++s) {
+                if (leaf[s] < 0) {
+                    continue;
+                }
+                auto depth = u32(0);
+                for (auto n = leaf[s]; nodes[n].parent >= 0; n = nodes[n].parent) {
+                    depth += 1;
+                }
+                lengths[s] = u8(std::min(depth, max_length + 1));
+                deepest = std::max(deepest, depth);
+            }
+            if (deepest <= max_length) {
+                return lengths;
+            }
+            for (auto& f : frequency) {
+                f = f == 0 ? 0 : (f + 1) / 2;
+            }
+        }
+    }
+
+    // Codes are emitted most significant bit first, so they are stored reversed
+    // for the LSB-first bit writer.
+    static auto canonical_codes(std::array<u8, symbols> const& lengths) -> std::array<u16, symbols> {
+        auto count = std::array<u16, max_length + 1>{};
+        for (auto len : lengths) {
+            count[len] += 1;
+        }
+        count[0] = 0;
+
+        auto next = std::array<u32, max_length + 1>{};
+        auto code = u32(0);
+        for (u32 len = 1; len <= max_length; ++len) {
+            code = (code + count[len - 1]) << 1;
+            next[len] = code;
+        }
+
+        auto codes = std::array<u16, symbols>{};
+        for (u32 s = 0; s < symbols; ++s) {
+            auto len = lengths[s];
+            if (len == 0) {
+                continue;
+            }
+            auto value = next[len]++;
+            auto reversed = u32(0);
+            for (u32 b = 0; b < len; ++b) {
+                reversed |= ((value >> b) & 1) << (len - 1 - b);
+            }
+            codes[s] = u16(reversed);
+        }
+        return codes;
+    }
+};
+
+struct TablebaseWriter {
+    static auto write(char const* path, std::span<u8 const> values, u32 block_size = TablebaseLayout::block_size) -> bool {
+        if (block_size == 0 || block_size > TablebaseLayout::max_block_size) {
+            return false;
+        }
+        auto file = File(std::fopen(path, "wb"));
+        if (file == nullptr) {
+            return false;
+        }
+
+        auto header = TablebaseHeader{
+            .entries = values.size(),
+            .block_size = block_size,
+            .blocks = u32((values.size() + block_size - 1) / block_size),
+        };
+
+        auto offsets = std::vector<u64>{0};
+        auto data = std::vector<u8>{};
+        for (u32 b = 0; b < header.blocks; ++b) {
+            auto begin = size_t(b) * block_size;
+            auto block = BlockCoder::encode(values.subspan(begin, std::min<size_t>(block_size, values.size() - begin)));
+            data.insert(data.end(), block.begin(), block.end());
+            offsets.push_back(data.size());
+        }
+
+        return std::fwrite(&header, sizeof(header), 1, file.get()) == 1
+            && std::fwrite(offsets.data(), sizeof(u64), offsets.size(), file.get()) == offsets.size()
+            && std::fwrite(data.data(), 1, data.size(), file.get()) == data.size();
+    }
+};
+
+// Random-access reader. Only the block index is kept in memory; blocks are
+// read on demand and the most recently used ones stay decoded in a fixed
+// number of cache slots. Not thread-safe: give each search thread its own.
+//
+// Nothing read from the file sizes an allocation before it is checked
+// against the file's length, so a truncated or corrupt table fails to open
+// instead of allocating or seeking wherever its header points.
+struct Tablebase {
+    static auto open(char const* path, u32 cache_blocks = 64) -> Option<Tablebase> {
+        auto file = File(std::fopen(path, "rb"));
+        if (file == nullptr || std::fseek(file.get(), 0, SEEK_END) != 0) {
+            return None;
+        }
+        auto file_size = std::ftell(file.get());
+        std::rewind(file.get());
+
+        TablebaseHeader header;
+        if (file_size < 0 || std::fread(&header, sizeof(header), 1, file.get()) != 1) {
+            return None;
+        }
+        if (header.magic != TablebaseLayout::magic || header.version != TablebaseLayout::version) {
+            return None;
+        }
+        if (header.block_size == 0 || header.block_size > TablebaseLayout::max_block_size) {
+            return None;
+        }
+        if (header.blocks != header.entries / header.block_size + u64(header.entries % header.block_size != 0)) {
+            return None;
+        }
+        auto data_start = sizeof(TablebaseHeader) + (u64(header.blocks) + 1) * sizeof(u64);
+        if (data_start > u64(file_size)) {
+            return None;
+        }
+
+        auto offsets = std::vector<u64>(size_t(header.blocks) + 1);
+        if (std::fread(offsets.data(), sizeof(u64), offsets.size(), file.get()) != offsets.size()) {
+            return None;
+        }
+        if (offsets[0] != 0 || !std::is_sorted(offsets.begin(), offsets.end()) || offsets.back() != u64(file_size) - data_start) {
+            return None;
+        }
+        return Some(Tablebase(std::move(file), header, std::move(offsets), std::max(1U, cache_blocks)));
+    }
+
+    [[nodiscard]] auto entries() const -> u64 {
+        return header.entries;
+    }
+
+    [[nodiscard]] auto compressed_bytes() const -> u64 {
+        return offsets.back();
+    }
+
+    [[nodiscard]] auto hits() const -> u64 {
+        return cache_hits;
+    }
+
+    [[nodiscard]] auto misses() const -> u64 {
+        return cache_misses;
+    }
+
+    // None only if the file is truncated or corrupt.
+    auto probe(u64 index) -> Option<u8> {
+        if (index >= header.entries) {
+            return None;
+        }
+        auto block = u32(index / header.block_size);
+        auto slot = block_slot[block];
+        if (slot != empty) {
+            cache_hits += 1;
+            touch(slot);
+        } else {
+            cache_misses += 1;
+            slot = tail_slot();
+            if (!load(block, slot)) {
+                return None;
+            }
+            touch(slot);
+        }
+        return Some(u8(cache[size_t(slot) * header.block_size + index % header.block_size]));
+    }
+
+private:
+    static constexpr u32 empty = std::numeric_limits<u32>::max();
+
+    // Cache slots form a doubly linked list in recency order; `head` is the
+    // most recently used slot, its predecessor chain ends at the eviction victim.
+    struct Slot {
+        u32 block = empty;
+        u32 prev  = {};
+        u32 next  = {};
+    };
+
+    File              file;
+    TablebaseHeader   header;
+    std::vector<u64>  offsets;
+    std::vector<u32>  block_slot;
+    std::vector<Slot> slots;
+    std::vector<u8>   cache;
+    std::vector<u8>   scratch      = {};
+    u32               head         = {};
+    u64               cache_hits   = {};
+    u64               cache_misses = {};
+
+    Tablebase(File file, TablebaseHeader header, std::vector<u64> offsets, u32 cache_blocks)
+        : file(std::move(file))
+        , header(header)
+        , offsets(std::move(offsets))
+        , block_slot(header.blocks, empty)
+        , slots(std::min(cache_blocks, std::max(1U, header.blocks)))
+        , cache(slots.size() * header.block_size) {
+        auto n = u32(slots.size());
+        for (u32 i = 0; i < n; ++i) {
+            slots[i].prev = (i + n - 1) % n;
+            slots[i].next = (i + 1) % n;
+        }
+    }
+
+    [[nodiscard]] auto tail_slot() const -> u32 {
+        return slots[head].prev;
+    }
+
+    void touch(u32 slot) {
+        if (slot == head) {
+            return;
+        }
+        slots[slots[slot].prev].next = slots[slot].next;
+        slots[slots[slot].next].prev = slots[slot].prev;
+        auto tail = slots[head].prev;
+        slots[slot].prev = tail;
+        slots[slot].next = head;
+        slots[tail].next = slot;
+        slots[head].prev = slot;
+        head = slot;
+    }
+
+    auto load(u32 block, u32 slot) -> bool {
+        if (slots[slot].block != empty) {
+            block_slot[slots[slot].block] = empty;
+            slots[slot].block = empty;
+        }
+
+        auto data_start = sizeof(TablebaseHeader) + offsets.size() * sizeof(u64);
+        auto size = offsets[block + 1] - offsets[block];
+        scratch.resize(size);
+        if (std::fseek(file.get(), long(data_start + offsets[block]), SEEK_SET) != 0) {
+            return false;
+        }
+        if (std::fread(scratch.data(), 1, size, file.get()) != size) {
+            return false;
+        }
+
+        auto first = u64(block) * header.block_size;
+        auto length = std::min<u64>(header.block_size, header.entries - first);
+        auto values = std::span<u8>(cache.data() + size_t(slot) * header.block_size, length);
+        if (!BlockCoder::decode(scratch, values)) {
+            return false;
+        }
+        slots[slot].block = block;
+        block_slot[block] = slot;
+        return true;
+    }
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "position.hpp"
+
+// Time left on the mover's clock and what it gains after each move.
+struct Clock {
+    std::chrono::milliseconds remaining = {};
+    std::chrono::milliseconds increment = {};
+};
+
+// Splits a clock into a soft target, checked between iterations, and a hard
+// cap the search polls for. The target grows while the best move keeps
+// changing between iterations and decays back once it settles.
+struct TimeManager {
+    static constexpr i64 overhead_ms   = 20;
+    static constexpr i32 moves_planned = 60;
+    static constexpr i32 moves_minimum = 10;
+
+    std::chrono::milliseconds optimum     = {};
+    std::chrono::milliseconds maximum     = {};
+    f64                       instability = {};
+    Option<Move>              last_best   = None;
+
+    static auto new_(Clock const& clock, u16 ply) -> TimeManager {
+        auto remaining = std::max<i64>(0, clock.remaining.count() - overhead_ms);
+        auto increment = clock.increment.count();
+        auto moves_left = std::max(moves_minimum, moves_planned - i32(ply / 2));
+
+        auto optimum = remaining / moves_left + increment * 3 / 4;
+        // The increment only arrives after the move, so it never lifts the
+        // cap above what is actually on the clock.
+        auto maximum = std::min({remaining / 8 + increment, optimum * 4, remaining / 2});
+        return TimeManager{
+            .optimum = std::chrono::milliseconds(std::min(optimum, maximum)),
+            .maximum = std::chrono::milliseconds(std::max<i64>(maximum, 1)),
+        };
+    }
+
+    // Called after every completed iteration with the durations of the last
+    // two. The next one is predicted from their ratio and only started if it
+    // should finish within the (stretched) target; an iteration cut off by
+    // the hard cap is wasted work.
+    auto next_iteration(Option<Move> best, f64 elapsed_ms, f64 last_ms, f64 previous_ms) -> bool {
+        if (last_best && best && *best != *last_best) {
+            instability += 1.0;
+        }
+        instability *= 0.6;
+        last_best = best;
+
+        auto growth = previous_ms > 0.0 ? std::clamp(last_ms / previous_ms, 2.0, 8.0) : 4.0;
+        auto target = f64(optimum.count()) * (1.0 + 2.0 * instability);
+        return elapsed_ms + last_ms * growth <= target;
+    }
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "position.hpp"
+
+struct Score {
+    static constexpr i32 infinity = 32000;
+    static constexpr i32 win      = 30000;
+    static constexpr i32 decided  = win - 1024;
+
+    static constexpr auto from_outcome(Outcome outcome, Side side, i32 ply) -> i32 {
+        switch (outcome) {
+            case Outcome::WhiteWins: {
+                return side == Side::White ? win - ply : -win + ply;
+            }
+            case Outcome::BlackWins: {
+                return side == Side::Black ? win - ply : -win + ply;
+            }
+            default: {
+                return 0;
+            }
+        }
+    }
+
+    // Decided scores are stored relative to the node so they stay valid at any ply.
+    static constexpr auto to_tt(i32 score, i32 ply) -> i32 {
+        if (score >= decided) { return score + ply; }
+        if (score <= -decided) { return score - ply; }
+        return score;
+    }
+
+    static constexpr auto from_tt(i32 score, i32 ply) -> i32 {
+        if (score >= decided) { return score - ply; }
+        if (score <= -decided) { return score + ply; }
+        return score;
+    }
+};
+
+enum class Bound : u8 {
+    None,
+    Exact,
+    Lower,
+    Upper,
+};
+
+struct TranspositionTable {
+    struct Entry {
+        u64   key   = {};
+        i16   score = {};
+        i8    depth = {};
+        Bound bound = {};
+        Move  move  = {};
+    };
+
+    static auto new_(size_t megabytes) -> TranspositionTable {
+        auto count = std::bit_floor(std::max<size_t>(megabytes * 1024 * 1024 / sizeof(Entry), 1024));
+        auto table = TranspositionTable{};
+        table.entries.resize(count);
+        table.mask = count - 1;
+        return table;
+    }
+
+    auto probe(u64 key) -> Entry const* {
+        auto& entry = entries[key & mask];
+        return entry.key == key && entry.bound != Bound::None ? &entry : nullptr;
+    }
+
+    void store(u64 key, i32 score, i32 depth, Bound bound, Move move) {
+        auto& entry = entries[key & mask];
+        if (entry.key == key && entry.depth > depth && bound != Bound::Exact) {
+            return;
+        }
+        entry = Entry{
+            .key = key,
+            .score = i16(score),
+            .depth = i8(depth),
+            .bound = bound,
+            .move = move,
+        };
+    }
+
+    void clear() {
+        std::fill(entries.begin(), entries.end(), Entry{});
+    }
+
+    [[nodiscard]] auto capacity() const -> size_t {
+        return entries.size();
+    }
+
+private:
+    std::vector<Entry> entries = {};
+    u64                mask    = {};
+};
@@ -0,0 +1,268 @@
+#include "dataset.hpp"
+#include "eval.hpp"
+
+#include <cstdlib>
+#include <string_view>
+
+// Weight vector layout: 64 distance entries, then home, blocked and tempo.
+struct TuneLayout {
+    static constexpr u32 home    = 64;
+    static constexpr u32 blocked = 65;
+    static constexpr u32 tempo   = 66;
+    static constexpr u32 size    = 67;
+};
+
+using Weights = std::array<f64, TuneLayout::size>;
+
+struct TuneConfig {
+    std::string         data    = {};
+    Option<std::string> init    = None;
+    std::string         output  = "eval.params";
+    u32                 epochs  = 20;
+    u32                 threads = std::max(1U, std::thread::hardware_concurrency());
+    size_t              batch   = 1 << 20;
+    f64                 rate    = 0.5;
+    f64                 scale   = 1.0 / 128.0;
+};
+
+// Calls `fn(index, coefficient)` for every non-zero feature of the
+// White-relative evaluation, which is linear in the weights.
+template<typename Fn>
+static void for_each_feature(Sample const& sample, Fn&& fn) {
+    auto position = Position{
+        .white = sample.white,
+        .black = sample.black,
+        .hash = {},
+        .mirror_hash = {},
+        .ply = sample.ply,
+        .side = Side(sample.side),
+    };
+
+    for (auto side : {Side::White, Side::Black}) {
+        auto sign = side == Side::White ? 1.0 : -1.0;
+        auto pieces = position.pieces(side);
+        for (auto bits = pieces; bits != 0; bits &= bits - 1) {
+            fn(u32(Evaluator::oriented(side, std::countr_zero(bits))), sign);
+        }
+        fn(TuneLayout::home, -sign * f64(std::popcount(pieces & Bitboard::home(side))));
+        fn(TuneLayout::blocked, -sign * f64(std::popcount(Evaluator::blocked(position, side))));
+    }
+    fn(TuneLayout::tempo, position.side == Side::White ? 1.0 : -1.0);
+}
+
+static auto to_weights(EvalParams const& params) -> Weights {
+    Weights weights = {};
+    for (u32 i = 0; i < 64; ++i) {
+        weights[i] = f64(params.distance[i]);
+    }
+    weights[TuneLayout::home] = f64(params.home);
+    weights[TuneLayout::blocked] = f64(params.blocked);
+    weights[TuneLayout::tempo] = f64(params.tempo);
+    return weights;
+}
+
+static auto to_params(Weights const& weights) -> EvalParams {
+    EvalParams params = {};
+    for (u32 i = 0; i < 64; ++i) {
+        params.distance[i] = i32(std::lround(weights[i]));
+    }
+    params.home = i32(std::lround(weights[TuneLayout::home]));
+    params.blocked = i32(std::lround(weights[TuneLayout::blocked]));
+    params.tempo = i32(std::lround(weights[TuneLayout::tempo]));
+    return params;
+}
+
+struct Gradient {
+    Weights values = {};
+    f64     loss   = {};
+    u64     count  = {};
+
+    void merge(Gradient const& other) {
+        for (u32 i = 0; i < TuneLayout::size; ++i) {
+            values[i] += other.values[i];
+        }
+        loss += other.loss;
+        count += other.count;
+    }
+};
+
+// Cross-entropy between sigmoid(scale * eval) and the game result.
+static auto compute_gradient(std::span<Sample const> samples, Weights const& weights, f64 scale) -> Gradient {
+    Gradient gradient = {};
+    for (auto& sample : samples) {
+        f64 eval = 0.0;
+        for_each_feature(sample, [&](u32 index, f64 value) {
+            eval += weights[index] * value;
+        });
+
+        auto target = 0.5 * (f64(sample.result) + 1.0);
+        auto p = 1.0 / (1.0 + std::exp(-scale * eval));
+        auto clamped = std::clamp(p, 1e-12, 1.0 - 1e-12);
+        gradient.loss -= target * std::log(clamped) + (1.0 - target) * std::log(1.0 - clamped);
+
+        auto delta = scale * (p - target);
+        for_each_feature(sample, [&](u32 index, f64 value) {
+            gradient.values[index] += delta * value;
+        });
+    }
+    gradient.count = samples.size();
+    return gradient;
+}
+
+static auto parallel_gradient(std::span<Sample const> samples, Weights const& weights, TuneConfig const& config) -> Gradient {
+    auto threads = std::min<size_t>(config.threads, std::max<size_t>(1, samples.size()));
+    auto partial = std::vector<Gradient>(threads);
+    auto workers = std::vector<std::thread>{};
+    for (size_t t = 0; t < threads; ++t) {
+        auto begin = samples.size() * t / threads;
+        auto end = samples.size() * (t + 1) / threads;
+        workers.emplace_back([&, t, begin, end]() {
+            partial[t] = compute_gradient(samples.subspan(begin, end - begin), weights, config.scale);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    Gradient total = {};
+    for (auto& gradient : partial) {
+        total.merge(gradient);
+    }
+    return total;
+}
+
+struct Adam {
+    static constexpr f64 beta1   = 0.9;
+    static constexpr f64 beta2   = 0.999;
+    static constexpr f64 epsilon = 1e-8;
+
+    Weights m = {};
+    Weights v = {};
+    u64     t = {};
+
+    void step(Weights& weights, Gradient const& gradient, f64 rate) {
+        t += 1;
+        auto correction1 = 1.0 - std::pow(beta1, f64(t));
+        auto correction2 = 1.0 - std::pow(beta2, f64(t));
+        for (u32 i = 0; i < TuneLayout::size; ++i) {
+            auto g = gradient.values[i] / f64(gradient.count);
+            m[i] = beta1 * m[i] + (1.0 - beta1) * g;
+            v[i] = beta2 * v[i] + (1.0 - beta2) * g * g;
+            weights[i] -= rate * (m[i] / correction1) / (std::sqrt(v[i] / correction2) + epsilon);
+        }
+    }
+};
+
+static void print_usage() {
+    fmt::print(
+        "usage: corners_tune DATA [options]\n"
+        "  --epochs N      passes over the data (20)\n"
+        "  --threads N     worker threads (all cores)\n"
+        "  --batch N       samples per gradient step (1048576)\n"
+        "  --rate F        Adam learning rate (0.5)\n"
+        "  --scale F       sigmoid scale applied to the eval (0.0078125)\n"
+        "  --init FILE     start from these parameters instead of the defaults\n"
+        "  --out FILE      where to write the tuned parameters (eval.params)\n"
+    );
+}
+
+static auto parse_args(i32 argc, const char* argv[]) -> Option<TuneConfig> {
+    auto config = TuneConfig{};
+    if (argc < 2) {
+        return None;
+    }
+    config.data = argv[1];
+    for (i32 i = 2; i + 1 < argc; i += 2) {
+        auto arg = std::string_view(argv[i]);
+        auto value = std::string_view(argv[i + 1]);
+
+        char* end = nullptr;
+        auto number = std::strtod(argv[i + 1], &end);
+        auto numeric = end == argv[i + 1] + value.size() && number >= 0.0;
+
+        if (arg == "--init") {
+            config.init = Some(std::string(value));
+        } else if (arg == "--out") {
+            config.output = std::string(value);
+        } else if (!numeric) {
+            return None;
+        } else if (arg == "--epochs") {
+            config.epochs = u32(number);
+        } else if (arg == "--threads") {
+            config.threads = std::max(1U, u32(number));
+        } else if (arg == "--batch") {
+            config.batch = std::max<size_t>(1, size_t(number));
+        } else if (arg == "--rate") {
+            config.rate = number;
+        } else if (arg == "--scale") {
+            config.scale = number;
+        } else {
+            return None;
+        }
+    }
+    if (argc % 2 != 0) {
+        return None;
+    }
+    return Some(std::move(config));
+}
+
+auto main(i32 argc, const char* argv[]) -> i32 {
+    auto parsed = parse_args(argc, argv);
+    if (!parsed) {
+        print_usage();
+        return 1;
+    }
+    auto config = std::move(parsed).unwrap();
+
+    auto params = EvalParams::new_();
+    if (config.init) {
+        auto loaded = EvalParams::load(config.init->c_str());
+        if (!loaded) {
+            fmt::print(stderr, "failed to load parameters '{}'\n", *config.init);
+            return 1;
+        }
+        params = *loaded;
+    }
+
+    auto reader = SampleReader::open(config.data.c_str(), config.batch);
+    if (!reader) {
+        fmt::print(stderr, "failed to open '{}'\n", config.data);
+        return 1;
+    }
+
+    auto weights = to_weights(params);
+    auto adam = Adam{};
+    for (u32 epoch = 0; epoch < config.epochs; ++epoch) {
+        auto started = std::chrono::steady_clock::now();
+        auto total = Gradient{};
+        reader->rewind();
+        while (true) {
+            auto samples = reader->next();
+            if (samples.empty()) {
+                break;
+            }
+            auto gradient = parallel_gradient(samples, weights, config);
+            adam.step(weights, gradient, config.rate);
+            total.loss += gradient.loss;
+            total.count += gradient.count;
+        }
+        if (total.count == 0) {
+            fmt::print(stderr, "no samples in '{}'\n", config.data);
+            return 1;
+        }
+
+        auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - started).count();
+        fmt::print(
+            "epoch {} loss {:.6f} ({} samples, {:.1f}M samples/s)\n",
+            epoch + 1, total.loss / f64(total.count), total.count, f64(total.count) / std::max(seconds, 1e-9) / 1e6
+        );
+        std::fflush(stdout);
+    }
+
+    if (!to_params(weights).save(config.output.c_str())) {
+        fmt::print(stderr, "failed to write '{}'\n", config.output);
+        return 1;
+    }
+    fmt::print("wrote {}\n", config.output);
+    return 0;
+}
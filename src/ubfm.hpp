@@ -0,0 +1,152 @@
+#pragma once
+
+#include "tt.hpp"
+
+#include <functional>
+
+struct BestFirstConfig {
+    u64 max_nodes = u64(16) << 20;
+};
+
+struct BestFirstResult {
+    Option<Move> best  = None;
+    i32          score = {};
+    i32          depth = {};
+    u64          nodes = {};
+};
+
+// Unbounded best-first minimax: every iteration follows the current best
+// line down to a leaf, expands it by evaluating all children and backs the
+// minimax values up again, so the tree only grows where the principal line
+// goes. Nodes live in the transposition table under a ply-salted key, which
+// keeps the graph acyclic. An entry of depth 0 is an evaluated leaf and depth
+// 1 an expanded node whose move is the best child still worth visiting;
+// Exact marks a value that is proven.
+struct BestFirst {
+    TranspositionTable&                 tt;
+    std::function<i32(Position const&)> evaluate;
+
+    template<typename Stop>
+    auto search(Position const& root, BestFirstConfig const& config, Stop&& stop) -> BestFirstResult {
+        auto result = BestFirstResult{};
+        auto budget = std::min<u64>(config.max_nodes, tt.capacity() / 4 * 3);
+        std::vector<Position> path;
+        while (true) {
+            path.clear();
+            path.push_back(root);
+            while (true) {
+                auto* entry = probe(path.back());
+                if (entry == nullptr || entry->depth == 0) {
+                    update(path.back(), result.nodes);
+                    break;
+                }
+                if (entry->bound == Bound::Exact) {
+                    break;
+                }
+                auto next = path.back();
+                next.make_move(next.is_mirrored() ? Symmetry::transpose(entry->move) : Move(entry->move));
+                path.push_back(next);
+            }
+            for (auto i = path.size() - 1; i-- > 0;) {
+                update(path[i], result.nodes);
+            }
+            result.depth = std::max(result.depth, i32(path.size() - 1));
+
+            auto* entry = probe(root);
+            if (entry == nullptr || entry->bound == Bound::Exact || result.nodes >= budget || stop(result.nodes)) {
+                break;
+            }
+        }
+
+        // The stored move may be an unproven runner-up, so pick the best child afresh.
+        MoveList list;
+        root.generate_moves(list);
+        auto best = -Score::infinity;
+        for (auto move : list) {
+            auto child = root;
+            child.make_move(move);
+            if (auto* entry = probe(child); entry != nullptr && -entry->score > best) {
+                best = -entry->score;
+                result.best = Some(Move(move));
+                result.score = relative(best, root.ply);
+            }
+        }
+        return result;
+    }
+
+private:
+    static auto key(Position const& position) -> u64 {
+        return position.canonical_hash() ^ (u64(position.ply) + 1) * 0x9E3779B97F4A7C15ULL;
+    }
+
+    // Decided scores are stored against the absolute ply, which is part of
+    // the key anyway; callers expect them counted from the root.
+    static auto relative(i32 score, u16 root_ply) -> i32 {
+        if (score >= Score::decided) { return score + root_ply; }
+        if (score <= -Score::decided) { return score - root_ply; }
+        return score;
+    }
+
+    auto probe(Position const& position) -> TranspositionTable::Entry const* {
+        return tt.probe(key(position));
+    }
+
+    // Value of `position` for the side to move, evaluating it if it is new.
+    auto leaf(Position const& position, u64& nodes) -> std::pair<i32, bool> {
+        if (auto* entry = probe(position)) {
+            return {entry->score, entry->bound == Bound::Exact};
+        }
+        nodes += 1;
+        auto outcome = position.outcome();
+        auto resolved = outcome != Outcome::None;
+        auto score = resolved ? Score::from_outcome(outcome, position.side, position.ply) : evaluate(position);
+        tt.store(key(position), score, 0, resolved ? Bound::Exact : Bound::Lower, Move{});
+        return {score, resolved};
+    }
+
+    // Recomputes a node from its children, expanding it on the first visit.
+    // It is proven once a proven child wins for the mover or every child is
+    // proven; otherwise it points at the best child that is not.
+    void update(Position const& position, u64& nodes) {
+        if (position.outcome() != Outcome::None) {
+            leaf(position, nodes);
+            return;
+        }
+        MoveList list;
+        position.generate_moves(list);
+        if (list.size == 0) {
+            tt.store(key(position), -Score::win + position.ply, 1, Bound::Exact, Move{});
+            return;
+        }
+
+        auto best = -Score::infinity;
+        auto best_move = list[0];
+        auto open = -Score::infinity;
+        auto open_move = list[0];
+        auto won = false;
+        auto all_resolved = true;
+        for (auto move : list) {
+            auto child = position;
+            child.make_move(move);
+            auto [score, resolved] = leaf(child, nodes);
+            score = -score;
+            if (score > best) {
+                best = score;
+                best_move = move;
+            }
+            if (resolved) {
+                won = won || score >= Score::decided;
+            } else {
+                all_resolved = false;
+                if (score > open) {
+                    open = score;
+                    open_move = move;
+                }
+            }
+        }
+
+        auto resolved = won || all_resolved;
+        auto move = resolved ? best_move : open_move;
+        tt.store(key(position), best, 1, resolved ? Bound::Exact : Bound::Lower, position.is_mirrored() ? Symmetry::transpose(move) : move);
+    }
+};